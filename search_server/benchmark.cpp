@@ -0,0 +1,414 @@
+// Воспроизводимый бенчмарк горячих путей SearchServer.
+// Корпуса синтетические: словарь с распределением Ципфа, настраиваемые длина документа
+// и доля стоп-слов, фиксированный seed. Результат - JSON Lines в stdout, по строке на операцию:
+// {"corpus_size":..., "operation":..., "ops":..., "ops_per_sec":..., "p50_us":..., ...}
+#include "log_duration.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	struct BenchmarkSettings
+	{
+		vector<int> corpus_sizes = {1'000, 5'000, 20'000};
+		int vocabulary_size = 10'000;
+		int document_length = 40;
+		double stop_word_ratio = 0.1;
+		double zipf_exponent = 1.07;
+		double duplicate_ratio = 0.02;
+		int query_count = 200;
+		int query_length = 6;
+		double minus_word_probability = 0.1;
+		int remove_count = 100;
+		uint32_t seed = 42;
+		// RemoveDuplicates всегда меряется с полным прямым индексом
+		ForwardIndexMode forward_index = ForwardIndexMode::FULL;
+	};
+
+	const vector<string> STOP_WORDS = {"a", "an", "and", "in", "of", "on", "the", "to", "with", "for"};
+
+	// Размер в килобайтах, ru_maxrss на Linux уже в них
+	long PeakRssKilobytes()
+	{
+#ifdef __unix__
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+#else
+		return 0;
+#endif
+	}
+
+	class ZipfSampler
+	{
+	  public:
+		ZipfSampler(int size, double exponent) : cumulative_(size)
+		{
+			double sum = 0;
+			for (int rank = 0; rank < size; ++rank)
+			{
+				sum += 1.0 / pow(rank + 1, exponent);
+				cumulative_[rank] = sum;
+			}
+			for (double& value : cumulative_)
+			{
+				value /= sum;
+			}
+		}
+
+		int operator()(mt19937& generator) const
+		{
+			const double point = uniform_real_distribution<>(0, 1)(generator);
+			const auto it = lower_bound(cumulative_.begin(), cumulative_.end(), point);
+			return static_cast<int>(min<ptrdiff_t>(it - cumulative_.begin(), cumulative_.size() - 1));
+		}
+
+	  private:
+		vector<double> cumulative_;
+	};
+
+	vector<string> GenerateVocabulary(mt19937& generator, int size)
+	{
+		set<string> unique_words(STOP_WORDS.begin(), STOP_WORDS.end());
+		vector<string> words;
+		words.reserve(size);
+		while (static_cast<int>(words.size()) < size)
+		{
+			const int length = uniform_int_distribution(3, 10)(generator);
+			string word;
+			for (int i = 0; i < length; ++i)
+			{
+				word.push_back(uniform_int_distribution('a', 'z')(generator));
+			}
+			if (unique_words.insert(word).second)
+			{
+				words.push_back(move(word));
+			}
+		}
+		return words;
+	}
+
+	struct Corpus
+	{
+		vector<string> documents;
+		vector<string> queries;
+	};
+
+	Corpus GenerateCorpus(mt19937& generator, const BenchmarkSettings& settings, int size,
+						  const vector<string>& vocabulary, const ZipfSampler& sampler)
+	{
+		Corpus corpus;
+		corpus.documents.reserve(size);
+		for (int id = 0; id < size; ++id)
+		{
+			if (id > 0 && uniform_real_distribution<>(0, 1)(generator) < settings.duplicate_ratio)
+			{
+				corpus.documents.push_back(corpus.documents[uniform_int_distribution(0, id - 1)(generator)]);
+				continue;
+			}
+			string text;
+			for (int i = 0; i < settings.document_length; ++i)
+			{
+				if (i > 0)
+				{
+					text.push_back(' ');
+				}
+				if (uniform_real_distribution<>(0, 1)(generator) < settings.stop_word_ratio)
+				{
+					text += STOP_WORDS[uniform_int_distribution<size_t>(0, STOP_WORDS.size() - 1)(generator)];
+				}
+				else
+				{
+					text += vocabulary[sampler(generator)];
+				}
+			}
+			corpus.documents.push_back(move(text));
+		}
+		for (int i = 0; i < settings.query_count; ++i)
+		{
+			string query;
+			for (int j = 0; j < settings.query_length; ++j)
+			{
+				if (j > 0)
+				{
+					query.push_back(' ');
+				}
+				if (uniform_real_distribution<>(0, 1)(generator) < settings.minus_word_probability)
+				{
+					query.push_back('-');
+				}
+				query += vocabulary[sampler(generator)];
+			}
+			corpus.queries.push_back(move(query));
+		}
+		return corpus;
+	}
+
+	class BenchmarkReport
+	{
+	  public:
+		BenchmarkReport(ostream& out, int corpus_size) : out_(out), corpus_size_(corpus_size)
+		{
+		}
+
+		// Замеряет каждый вызов op(i), i = [0, count)
+		template <typename Operation> void Measure(string_view name, int count, Operation op)
+		{
+			profile::Histogram histogram;
+			const auto start = profile::Clock::now();
+			for (int i = 0; i < count; ++i)
+			{
+				const auto op_start = profile::Clock::now();
+				op(i);
+				histogram.Record(Nanoseconds(profile::Clock::now() - op_start));
+			}
+			Print(name, count, Nanoseconds(profile::Clock::now() - start), histogram);
+		}
+
+		// Одна пакетная операция над count элементами
+		template <typename Operation> void MeasureBatch(string_view name, int count, Operation op)
+		{
+			profile::Histogram histogram;
+			const auto start = profile::Clock::now();
+			op();
+			const uint64_t elapsed = Nanoseconds(profile::Clock::now() - start);
+			histogram.Record(elapsed);
+			Print(name, count, elapsed, histogram);
+		}
+
+		// Размер индекса после загрузки корпуса: отдельная строка с operation "IndexStats"
+		void PrintIndexStats(const IndexStats& stats)
+		{
+			const IndexMemoryUsage& memory = stats.memory;
+			out_ << "{\"corpus_size\":" << corpus_size_ << ",\"operation\":\"IndexStats\",\"terms\":" << stats.term_count
+				 << ",\"postings\":" << stats.posting_count
+				 << ",\"postings_per_document\":" << stats.average_postings_per_document
+				 << ",\"dictionary_bytes\":" << memory.dictionary << ",\"postings_bytes\":" << memory.postings
+				 << ",\"forward_index_bytes\":" << memory.forward_index
+				 << ",\"documents_bytes\":" << memory.documents << ",\"positions_bytes\":" << memory.positions
+				 << ",\"total_bytes\":" << memory.Total() << "}" << endl;
+		}
+
+	  private:
+		static uint64_t Nanoseconds(profile::Clock::duration duration)
+		{
+			return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(duration).count());
+		}
+
+		void Print(string_view name, int count, uint64_t elapsed_ns, const profile::Histogram& histogram)
+		{
+			profile::Histogram::Snapshot snapshot;
+			snapshot.Merge(histogram);
+			const auto to_us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+			const double seconds = static_cast<double>(elapsed_ns) / 1e9;
+			out_ << "{\"corpus_size\":" << corpus_size_ << ",\"operation\":\"" << name << "\",\"ops\":" << count
+				 << ",\"total_ms\":" << static_cast<double>(elapsed_ns) / 1e6
+				 << ",\"ops_per_sec\":" << (seconds > 0 ? count / seconds : 0.0)
+				 << ",\"p50_us\":" << to_us(snapshot.Percentile(0.5))
+				 << ",\"p90_us\":" << to_us(snapshot.Percentile(0.9))
+				 << ",\"p99_us\":" << to_us(snapshot.Percentile(0.99)) << ",\"max_us\":" << to_us(snapshot.max)
+				 << ",\"peak_rss_kb\":" << PeakRssKilobytes() << "}" << endl;
+		}
+
+		ostream& out_;
+		int corpus_size_;
+	};
+
+	void RunCorpus(ostream& out, const BenchmarkSettings& settings, int size, const vector<string>& vocabulary,
+				   const ZipfSampler& sampler)
+	{
+		// seed зависит от размера, чтобы корпус не зависел от набора запускаемых размеров
+		mt19937 generator(settings.seed + size);
+		const Corpus corpus = GenerateCorpus(generator, settings, size, vocabulary, sampler);
+		const int query_count = static_cast<int>(corpus.queries.size());
+		BenchmarkReport report(out, size);
+
+		ostringstream stop_words;
+		for (const string& word : STOP_WORDS)
+		{
+			stop_words << word << ' ';
+		}
+		SearchServer search_server(stop_words.str(), SearchServerOptions{false, settings.forward_index});
+
+		report.Measure("AddDocument"sv, size, [&](int id) {
+			search_server.AddDocument(id, corpus.documents[id], DocumentStatus::ACTUAL, {id % 10, 5});
+		});
+		report.PrintIndexStats(search_server.GetIndexStats());
+		report.Measure("GetIndexStats"sv, 10, [&](int) { search_server.GetIndexStats(); });
+		report.Measure("FindTopDocuments.seq"sv, query_count,
+					   [&](int i) { search_server.FindTopDocuments(execution::seq, corpus.queries[i]); });
+		report.Measure("FindTopDocuments.par"sv, query_count,
+					   [&](int i) { search_server.FindTopDocuments(execution::par, corpus.queries[i]); });
+		report.Measure("FindTopDocuments.bm25"sv, query_count,
+					   [&](int i) { search_server.FindTopDocuments(corpus.queries[i], RankingFunction::BM25); });
+		report.Measure("MatchDocument.seq"sv, query_count, [&](int i) {
+			search_server.MatchDocument(execution::seq, corpus.queries[i], i % size);
+		});
+		report.Measure("MatchDocument.par"sv, query_count, [&](int i) {
+			search_server.MatchDocument(execution::par, corpus.queries[i], i % size);
+		});
+		report.Measure("FindTopDocuments.prefix"sv, query_count, [&](int i) {
+			const string_view query = corpus.queries[i];
+			search_server.FindTopDocuments(string(query.substr(0, min<size_t>(query.find(' '), 3))) + "*"s);
+		});
+		report.MeasureBatch("ProcessQueries"sv, query_count,
+							[&] { ProcessQueries(search_server, corpus.queries); });
+
+		{
+			// RemoveDuplicates печатает каждый найденный дубликат, в отчёт это попасть не должно
+			ostringstream sink;
+			auto* const cout_buffer = cout.rdbuf(sink.rdbuf());
+			SearchServer deduplicated(stop_words.str());
+			for (int id = 0; id < size; ++id)
+			{
+				deduplicated.AddDocument(id, corpus.documents[id], DocumentStatus::ACTUAL, {id % 10, 5});
+			}
+			const int count = deduplicated.GetDocumentCount();
+			report.MeasureBatch("RemoveDuplicates"sv, count, [&] { RemoveDuplicates(deduplicated); });
+			cout.rdbuf(cout_buffer);
+		}
+
+		const int remove_count = min(settings.remove_count, size);
+		report.Measure("RemoveDocument.seq"sv, remove_count / 2,
+					   [&](int i) { search_server.RemoveDocument(execution::seq, i); });
+		report.Measure("RemoveDocument.par"sv, remove_count - remove_count / 2,
+					   [&](int i) { search_server.RemoveDocument(execution::par, remove_count / 2 + i); });
+	}
+
+	ForwardIndexMode ParseForwardIndexMode(const string& text)
+	{
+		if (text == "full"sv)
+		{
+			return ForwardIndexMode::FULL;
+		}
+		if (text == "compact"sv)
+		{
+			return ForwardIndexMode::COMPACT;
+		}
+		if (text == "none"sv)
+		{
+			return ForwardIndexMode::NONE;
+		}
+		throw invalid_argument("Unknown forward index mode "s + text);
+	}
+
+	vector<int> ParseSizes(const string& text)
+	{
+		vector<int> sizes;
+		istringstream input(text);
+		string item;
+		while (getline(input, item, ','))
+		{
+			sizes.push_back(stoi(item));
+		}
+		return sizes;
+	}
+
+	BenchmarkSettings ParseArguments(int argc, char* argv[])
+	{
+		BenchmarkSettings settings;
+		for (int i = 1; i < argc; ++i)
+		{
+			const string_view key = argv[i];
+			if (i + 1 == argc)
+			{
+				throw invalid_argument("Missing value for "s + string(key));
+			}
+			const string value = argv[++i];
+			if (key == "--sizes"sv)
+			{
+				settings.corpus_sizes = ParseSizes(value);
+			}
+			else if (key == "--vocabulary"sv)
+			{
+				settings.vocabulary_size = stoi(value);
+			}
+			else if (key == "--doc-length"sv)
+			{
+				settings.document_length = stoi(value);
+			}
+			else if (key == "--stop-ratio"sv)
+			{
+				settings.stop_word_ratio = stod(value);
+			}
+			else if (key == "--zipf"sv)
+			{
+				settings.zipf_exponent = stod(value);
+			}
+			else if (key == "--duplicates"sv)
+			{
+				settings.duplicate_ratio = stod(value);
+			}
+			else if (key == "--queries"sv)
+			{
+				settings.query_count = stoi(value);
+			}
+			else if (key == "--query-length"sv)
+			{
+				settings.query_length = stoi(value);
+			}
+			else if (key == "--removes"sv)
+			{
+				settings.remove_count = stoi(value);
+			}
+			else if (key == "--forward-index"sv)
+			{
+				settings.forward_index = ParseForwardIndexMode(value);
+			}
+			else if (key == "--seed"sv)
+			{
+				settings.seed = static_cast<uint32_t>(stoul(value));
+			}
+			else
+			{
+				throw invalid_argument("Unknown option "s + string(key));
+			}
+		}
+		return settings;
+	}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const BenchmarkSettings settings = ParseArguments(argc, argv);
+		mt19937 generator(settings.seed);
+		const vector<string> vocabulary = GenerateVocabulary(generator, settings.vocabulary_size);
+		const ZipfSampler sampler(settings.vocabulary_size, settings.zipf_exponent);
+		// отдельный поток поверх буфера stdout: cout на время RemoveDuplicates подменяется
+		ostream out(cout.rdbuf());
+		for (const int size : settings.corpus_sizes)
+		{
+			RunCorpus(out, settings, size, vocabulary, sampler);
+		}
+	}
+	catch (const exception& e)
+	{
+		cerr << e.what() << endl;
+		cerr << "Usage: search_server_benchmark [--sizes 1000,5000,20000] [--vocabulary N] [--doc-length N] "
+				"[--stop-ratio R] [--zipf S] [--duplicates R] [--queries N] [--query-length N] [--removes N] "
+				"[--forward-index full|compact|none] [--seed N]"
+			 << endl;
+		return 1;
+	}
+}
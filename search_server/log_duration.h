@@ -1,12 +1,35 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
-#define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
+
+// LOG_DURATION ничего не печатает: время попадает в гистограмму именованного скоупа
+// текущего потока, отчёт снимается через profile::Report или profile::PeriodicReport.
+// С -DPROFILE_DISABLE скоупы не компилируются вовсе.
+#ifdef PROFILE_DISABLE
+#define LOG_DURATION(x) static_cast<void>(0)
+#else
+#define LOG_DURATION(x) profile::ScopedTimer UNIQUE_VAR_NAME_PROFILE{x}
+#endif
+// Старое поведение: вывести длительность в поток при выходе из скоупа
 #define LOG_DURATION_STREAM(X, Y) LogDuration UNIQUE_VAR_NAME_PROFILE(X, Y)
 
 class LogDuration {
@@ -31,4 +54,247 @@ private:
 	const Clock::time_point start_time_ = Clock::now();
 	std::string name_ = {};
 	std::ostream &stream;
-};
\ No newline at end of file
+};
+
+namespace profile {
+
+	using Clock = std::chrono::steady_clock;
+
+	// Гистограмма в стиле HDR: 16 линейных под-корзин на каждую степень двойки,
+	// относительная погрешность квантилей не больше 1/16.
+	// Пишет только поток-владелец, поэтому хватает relaxed load + store без lock-префикса,
+	// читатели (Report) видят согласованные по отдельности счётчики.
+	class Histogram {
+	public:
+		static constexpr int SUB_BUCKET_BITS = 4;
+		static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+		static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+		static size_t BucketIndex(uint64_t value) {
+			if (value < SUB_BUCKETS) {
+				return static_cast<size_t>(value);
+			}
+			const int msb = std::bit_width(value) - 1;
+			const int shift = msb - SUB_BUCKET_BITS;
+			return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1)));
+		}
+
+		// Верхняя граница значений, попадающих в корзину
+		static uint64_t BucketHighValue(size_t index) {
+			if (index < SUB_BUCKETS) {
+				return index;
+			}
+			const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+			const uint64_t low = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+			return low + ((uint64_t{1} << shift) - 1);
+		}
+
+		void Record(uint64_t value) {
+			Bump(buckets_[BucketIndex(value)], 1);
+			Bump(count_, 1);
+			Bump(total_, value);
+			if (value > max_.load(std::memory_order_relaxed)) {
+				max_.store(value, std::memory_order_relaxed);
+			}
+		}
+
+		// Снимок для слияния гистограмм разных потоков
+		struct Snapshot {
+			std::array<uint64_t, BUCKET_COUNT> buckets{};
+			uint64_t count = 0;
+			uint64_t total = 0;
+			uint64_t max = 0;
+
+			void Merge(const Histogram &histogram) {
+				for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+					buckets[i] += histogram.buckets_[i].load(std::memory_order_relaxed);
+				}
+				count += histogram.count_.load(std::memory_order_relaxed);
+				total += histogram.total_.load(std::memory_order_relaxed);
+				max = std::max(max, histogram.max_.load(std::memory_order_relaxed));
+			}
+
+			uint64_t Percentile(double p) const {
+				uint64_t seen = 0;
+				for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+					seen += buckets[i];
+					if (seen > 0 && static_cast<double>(seen) >= p * static_cast<double>(count)) {
+						return std::min(BucketHighValue(i), max);
+					}
+				}
+				return max;
+			}
+		};
+
+	private:
+		static void Bump(std::atomic<uint64_t> &counter, uint64_t value) {
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+		std::atomic<uint64_t> count_{0};
+		std::atomic<uint64_t> total_{0};
+		std::atomic<uint64_t> max_{0};
+	};
+
+	// Узел дерева вложенных скоупов. Дети - односвязный список, новый ребёнок
+	// публикуется release-записью, поэтому читатель может обходить дерево без блокировок.
+	struct ScopeNode {
+		explicit ScopeNode(std::string_view scope_name, ScopeNode *parent_node)
+			: name(scope_name), parent(parent_node) {
+		}
+
+		const std::string name;
+		ScopeNode *const parent;
+		Histogram histogram;
+		std::atomic<ScopeNode *> first_child{nullptr};
+		std::atomic<ScopeNode *> next_sibling{nullptr};
+	};
+
+	// Профиль одного потока. Узлы живут в deque, чтобы указатели на них не инвалидировались.
+	// Сам deque трогает только поток-владелец: Report с другого потока идёт от root_ по указателям.
+	class ThreadProfile {
+	public:
+		ThreadProfile() : root_(&nodes_.emplace_back("", nullptr)), current_(root_) {
+		}
+
+		ScopeNode &Root() {
+			return *root_;
+		}
+
+		ScopeNode *Enter(std::string_view name) {
+			ScopeNode *child = current_->first_child.load(std::memory_order_relaxed);
+			for (; child != nullptr; child = child->next_sibling.load(std::memory_order_relaxed)) {
+				if (child->name == name) {
+					break;
+				}
+			}
+			if (child == nullptr) {
+				child = &nodes_.emplace_back(name, current_);
+				child->next_sibling.store(current_->first_child.load(std::memory_order_relaxed),
+										  std::memory_order_relaxed);
+				current_->first_child.store(child, std::memory_order_release);
+			}
+			current_ = child;
+			return child;
+		}
+
+		void Leave(ScopeNode *node, uint64_t nanoseconds) {
+			node->histogram.Record(nanoseconds);
+			current_ = node->parent;
+		}
+
+	private:
+		std::deque<ScopeNode> nodes_;
+		ScopeNode *const root_;
+		ScopeNode *current_;
+	};
+
+	// Все профили потоков; профиль переживает свой поток, чтобы его замеры попали в отчёт.
+	class Registry {
+	public:
+		static Registry &Instance() {
+			static Registry registry;
+			return registry;
+		}
+
+		ThreadProfile &Local() {
+			thread_local std::shared_ptr<ThreadProfile> local = Register();
+			return *local;
+		}
+
+		std::vector<std::shared_ptr<ThreadProfile>> Profiles() const {
+			std::lock_guard guard(mutex_);
+			return profiles_;
+		}
+
+	private:
+		std::shared_ptr<ThreadProfile> Register() {
+			auto profile = std::make_shared<ThreadProfile>();
+			std::lock_guard guard(mutex_);
+			profiles_.push_back(profile);
+			return profile;
+		}
+
+		mutable std::mutex mutex_;
+		std::vector<std::shared_ptr<ThreadProfile>> profiles_;
+	};
+
+	class ScopedTimer {
+	public:
+		explicit ScopedTimer(std::string_view name)
+			: profile_(Registry::Instance().Local()), node_(profile_.Enter(name)) {
+		}
+
+		ScopedTimer(const ScopedTimer &) = delete;
+		ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+		~ScopedTimer() {
+			const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_);
+			profile_.Leave(node_, static_cast<uint64_t>(duration.count()));
+		}
+
+	private:
+		ThreadProfile &profile_;
+		ScopeNode *node_;
+		const Clock::time_point start_time_ = Clock::now();
+	};
+
+	namespace detail {
+		// Дерево, слитое по путям скоупов из всех потоков
+		struct MergedScope {
+			Histogram::Snapshot snapshot;
+			std::map<std::string, MergedScope, std::less<>> children;
+		};
+
+		inline void MergeTree(const ScopeNode &node, MergedScope &merged) {
+			for (const ScopeNode *child = node.first_child.load(std::memory_order_acquire); child != nullptr;
+				 child = child->next_sibling.load(std::memory_order_acquire)) {
+				MergedScope &target = merged.children[child->name];
+				target.snapshot.Merge(child->histogram);
+				MergeTree(*child, target);
+			}
+		}
+
+		inline void PrintTree(const MergedScope &merged, std::ostream &out, int depth) {
+			using namespace std::literals;
+			const auto to_ms = [](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+			for (const auto &[name, scope] : merged.children) {
+				const auto &s = scope.snapshot;
+				out << std::string(depth * 2, ' ') << name << ": count="s << s.count << " p50="s
+					<< to_ms(s.Percentile(0.5)) << " ms p99="s << to_ms(s.Percentile(0.99)) << " ms max="s
+					<< to_ms(s.max) << " ms total="s << to_ms(s.total) << " ms"s << '\n';
+				PrintTree(scope, out, depth + 1);
+			}
+		}
+	} // namespace detail
+
+	// Отчёт по запросу: p50/p99/max для каждого скоупа, вложенность - отступами
+	inline void Report(std::ostream &out = std::cout) {
+		detail::MergedScope root;
+		for (const auto &profile : Registry::Instance().Profiles()) {
+			detail::MergeTree(profile->Root(), root);
+		}
+		detail::PrintTree(root, out, 0);
+		out.flush();
+	}
+
+	// Периодический отчёт из фонового потока, останавливается в деструкторе
+	class PeriodicReport {
+	public:
+		PeriodicReport(std::chrono::milliseconds period, std::ostream &out = std::cerr)
+			: worker_([this, period, &out](std::stop_token token) {
+				  std::unique_lock lock(mutex_);
+				  while (!cv_.wait_for(lock, token, period, [&token] { return token.stop_requested(); })) {
+					  Report(out);
+				  }
+			  }) {
+		}
+
+	private:
+		std::mutex mutex_;
+		std::condition_variable_any cv_;
+		std::jthread worker_;
+	};
+
+} // namespace profile
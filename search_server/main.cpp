@@ -634,6 +634,454 @@ void ParralelMatch()
 		// 0 words for document 3
 	}
 }
+// Гистограммы скоупов: корзины с погрешностью не больше 1/16, квантили, дерево вложенных скоупов
+void TestProfileHistograms()
+{
+	using std::string_literals::operator""s;
+	for (uint64_t value = 0; value < 100000; value += value / 7 + 1)
+	{
+		const uint64_t high = profile::Histogram::BucketHighValue(profile::Histogram::BucketIndex(value));
+		ASSERT(high >= value);
+		ASSERT(high - value <= value / profile::Histogram::SUB_BUCKETS);
+	}
+
+	profile::Histogram histogram;
+	for (uint64_t value = 1; value <= 1000; ++value)
+	{
+		histogram.Record(value);
+	}
+	profile::Histogram::Snapshot snapshot;
+	snapshot.Merge(histogram);
+	ASSERT_EQUAL(snapshot.count, 1000);
+	ASSERT_EQUAL(snapshot.total, 500500);
+	ASSERT_EQUAL(snapshot.max, 1000);
+	ASSERT(snapshot.Percentile(0.5) >= 500 && snapshot.Percentile(0.5) <= 500 + 500 / 16);
+	ASSERT(snapshot.Percentile(0.99) >= 990 && snapshot.Percentile(0.99) <= 1000);
+	ASSERT_EQUAL(snapshot.Percentile(1.0), 1000);
+	// слияние двух потоков складывает счётчики
+	snapshot.Merge(histogram);
+	ASSERT_EQUAL(snapshot.count, 2000);
+	ASSERT_EQUAL(snapshot.max, 1000);
+
+	// свой поток - свой профиль; отчёт сливает деревья по путям скоупов
+	std::thread worker([] {
+		for (int i = 0; i < 3; ++i)
+		{
+			profile::ScopedTimer outer("TestProfile.outer"s);
+			profile::ScopedTimer inner("TestProfile.inner"s);
+		}
+	});
+	worker.join();
+	ostringstream report;
+	profile::Report(report);
+	ASSERT(report.str().find("TestProfile.outer: count=3 "s) != string::npos);
+	ASSERT(report.str().find("\n  TestProfile.inner: count=3 "s) != string::npos);
+
+	// отчёт с другого потока, пока владелец заводит новые узлы
+	std::atomic<bool> done = false;
+	std::thread writer([&done] {
+		for (int i = 0; i < 2000; ++i)
+		{
+			profile::ScopedTimer timer("TestProfile.node"s + to_string(i));
+		}
+		done = true;
+	});
+	while (!done)
+	{
+		ostringstream sink;
+		profile::Report(sink);
+	}
+	writer.join();
+	ostringstream final_report;
+	profile::Report(final_report);
+	ASSERT(final_report.str().find("TestProfile.node1999: count=1 "s) != string::npos);
+}
+
+// BM25: при равном числе вхождений короткий документ релевантнее длинного,
+// TF-IDF по умолчанию не меняется
+void TestBm25Ranking()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "fluffy cat", DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "cat with a very long fluffy tail and whiskers", DocumentStatus::ACTUAL, {5});
+	search_server.AddDocument(3, "dog", DocumentStatus::ACTUAL, {1});
+
+	const auto tf_idf = search_server.FindTopDocuments("cat"s);
+	const auto tf_idf_explicit = search_server.FindTopDocuments("cat"s, RankingFunction::TF_IDF);
+	ASSERT_EQUAL(tf_idf.size(), 2);
+	ASSERT_EQUAL(tf_idf_explicit.size(), 2);
+	ASSERT(double_equals(tf_idf[0].relevance, tf_idf_explicit[0].relevance));
+
+	const auto bm25 = search_server.FindTopDocuments("cat"s, RankingFunction::BM25);
+	ASSERT_EQUAL(bm25.size(), 2);
+	ASSERT_EQUAL(bm25[0].id, 1);
+	ASSERT_EQUAL(bm25[1].id, 2);
+
+	// idf = ln((3 - 2 + 0.5) / (2 + 0.5) + 1), длина 2 при средней (2 + 7 + 1) / 3
+	const double idf = std::log(1.5 / 2.5 + 1.0);
+	const double norm = BM25_K1 * (1 - BM25_B + BM25_B * 2 / (10.0 / 3));
+	ASSERT(double_equals(bm25[0].relevance, idf * (BM25_K1 + 1) / (1 + norm)));
+
+	const auto bm25_par = search_server.FindTopDocuments(
+		std::execution::par, "cat -tail"s,
+		[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; },
+		RankingFunction::BM25);
+	ASSERT_EQUAL(bm25_par.size(), 1);
+	ASSERT(double_equals(bm25_par[0].relevance, bm25[0].relevance));
+
+	search_server.RemoveDocument(2);
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat"s, RankingFunction::BM25).size(), 1);
+}
+
+// MatchDocument через пересечение id термов: слова в лексикографическом порядке,
+// минус-слово обнуляет результат, слова живут в сервере, а не в исходном тексте
+void TestMatchDocumentTermIds()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, {1, 2});
+
+	{
+		const auto [words, status] = search_server.MatchDocument("rat pet unknown funny and"s, 1);
+		const std::vector<std::string_view> expected = {"funny"sv, "pet"sv, "rat"sv};
+		ASSERT_EQUAL(words, expected);
+		ASSERT_EQUAL(static_cast<int>(status), static_cast<int>(DocumentStatus::ACTUAL));
+	}
+	{
+		const auto [words, status] = search_server.MatchDocument(std::execution::par, "curly -hair pet"s, 2);
+		ASSERT(words.empty());
+		ASSERT_EQUAL(static_cast<int>(status), static_cast<int>(DocumentStatus::BANNED));
+	}
+	{
+		const auto [words, status] = search_server.MatchDocument(std::execution::seq, "curly -rat pet"s, 2);
+		const std::vector<std::string_view> expected = {"curly"sv, "pet"sv};
+		ASSERT_EQUAL(words, expected);
+	}
+	search_server.RemoveDocument(1);
+	ASSERT(search_server.FindTopDocuments("nasty"s).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("curly"s, DocumentStatus::BANNED).size(), 1);
+}
+
+// Фразовые запросы: точная фраза, фраза со стоп-словом внутри, фраза со slop,
+// и отказ без позиционного индекса
+void TestPhraseQueries()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with the"s, SearchServerOptions{.store_positions = true});
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "nasty pet with funny rat"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(3, "rat rat funny rat pet"s, DocumentStatus::ACTUAL, {3});
+
+	const auto ids = [](const std::vector<Document>& documents) {
+		std::set<int> result;
+		for (const Document& document : documents)
+		{
+			result.insert(document.id);
+		}
+		return result;
+	};
+
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments("\"funny pet\""s)), (std::set<int>{1}));
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments("\"funny rat\""s)), (std::set<int>{2, 3}));
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments("\"pet and nasty\""s)), (std::set<int>{1}));
+	ASSERT(search_server.FindTopDocuments("\"pet nasty\""s).empty());
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments("\"pet nasty\"~1"s)), (std::set<int>{1}));
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments("\"funny pet\"~2 -nasty"s)), (std::set<int>{3}));
+	ASSERT_EQUAL(ids(search_server.FindTopDocuments(std::execution::par, "\"rat rat\""s)), (std::set<int>{3}));
+
+	{
+		const auto [words, status] = search_server.MatchDocument("\"nasty rat\" funny"s, 1);
+		const std::vector<std::string_view> expected = {"funny"sv, "nasty"sv, "rat"sv};
+		ASSERT_EQUAL(words, expected);
+	}
+	ASSERT(std::get<0>(search_server.MatchDocument("\"nasty rat\" funny"s, 2)).empty());
+
+	search_server.RemoveDocument(1);
+	ASSERT(search_server.FindTopDocuments("\"funny pet\""s).empty());
+
+	SearchServer plain_server("and"s);
+	plain_server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, {1});
+	bool thrown = false;
+	try
+	{
+		plain_server.FindTopDocuments("\"funny pet\""s);
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	ASSERT(thrown);
+}
+
+// Префиксные запросы: раскрытие prefix* через словарь, минус-префикс, ограничение раскрытия
+void TestPrefixQueries()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "funky petrel with curly hair"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+
+	ASSERT_EQUAL(search_server.FindTopDocuments("fun*"s).size(), 2);
+	ASSERT_EQUAL(search_server.FindTopDocuments("pet*"s).size(), 2);
+	ASSERT_EQUAL(search_server.FindTopDocuments("pet* -curl*"s).size(), 1);
+	ASSERT_EQUAL(search_server.FindTopDocuments("petrel*"s)[0].id, 2);
+	ASSERT(search_server.FindTopDocuments("cat*"s).empty());
+
+	const std::vector<std::string_view> expected = {"funky"sv, "funny"sv};
+	ASSERT_EQUAL(search_server.FindTermsByPrefix("fun"sv), expected);
+	ASSERT_EQUAL(search_server.FindTermsByPrefix("f"sv, 1).size(), 1);
+
+	{
+		const auto [words, status] = search_server.MatchDocument("fun* hair"s, 2);
+		const std::vector<std::string_view> expected_words = {"funky"sv, "hair"sv};
+		ASSERT_EQUAL(words, expected_words);
+	}
+
+	// словарь пересобирается после добавления новых термов
+	search_server.AddDocument(4, "funnel"s, DocumentStatus::ACTUAL, {4});
+	ASSERT_EQUAL(search_server.FindTopDocuments("fun*"s).size(), 3);
+
+	// больше блока front-coding и больше лимита раскрытия
+	SearchServer big_server(""s);
+	std::vector<std::string> texts;
+	for (int i = 0; i < 100; ++i)
+	{
+		texts.push_back("word" + std::to_string(i));
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		big_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1});
+	}
+	ASSERT_EQUAL(big_server.FindTermsByPrefix("word"sv, 1000).size(), 100);
+	ASSERT_EQUAL(big_server.FindTermsByPrefix("word5"sv).size(), 11);
+	ASSERT_EQUAL(big_server.FindTermsByPrefix("word"sv).size(), MAX_PREFIX_EXPANSION);
+}
+
+// Асинхронный поиск: совпадает с синхронным, прерывается дедлайном и отменой,
+// тысячи запросов одновременно на небольшом пуле
+void TestAsyncFindTopDocuments()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with"s);
+	const std::vector<std::string> texts = {
+		"funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+		"pet with rat and rat and rat"s, "nasty rat with curly hair"s,
+	};
+	for (size_t i = 0; i < texts.size(); ++i)
+	{
+		search_server.AddDocument(static_cast<int>(i) + 1, texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+	}
+
+	QueryExecutor executor(2);
+	const auto far_deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+	{
+		const auto expected = search_server.FindTopDocuments("nasty rat -not"s);
+		auto result = search_server.FindTopDocumentsAsync(executor, "nasty rat -not"s, far_deadline).Get();
+		ASSERT(result.complete);
+		ASSERT_EQUAL(result.documents.size(), expected.size());
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			ASSERT_EQUAL(result.documents[i].id, expected[i].id);
+			ASSERT(double_equals(result.documents[i].relevance, expected[i].relevance));
+		}
+	}
+	{
+		auto bm25 = search_server
+						.FindTopDocumentsAsync(executor, "curly hair"s, far_deadline, {}, RankingFunction::BM25)
+						.Get();
+		const auto expected = search_server.FindTopDocuments("curly hair"s, RankingFunction::BM25);
+		ASSERT_EQUAL(bm25.documents.size(), expected.size());
+		ASSERT(double_equals(bm25.documents[0].relevance, expected[0].relevance));
+	}
+	{
+		auto expired =
+			search_server.FindTopDocumentsAsync(executor, "rat"s, std::chrono::steady_clock::now() - std::chrono::seconds(1)).Get();
+		ASSERT(!expired.complete);
+		ASSERT(expired.documents.empty());
+	}
+	{
+		std::stop_source cancel;
+		cancel.request_stop();
+		auto cancelled = search_server.FindTopDocumentsAsync(executor, "rat"s, far_deadline, cancel.get_token()).Get();
+		ASSERT(!cancelled.complete);
+	}
+	{
+		bool thrown = false;
+		try
+		{
+			search_server.FindTopDocumentsAsync(executor, "--rat"s, far_deadline).Get();
+		}
+		catch (const std::invalid_argument&)
+		{
+			thrown = true;
+		}
+		ASSERT(thrown);
+	}
+	{
+		std::vector<QueryFuture<AsyncSearchResult>> in_flight;
+		for (int i = 0; i < 2000; ++i)
+		{
+			in_flight.push_back(search_server.FindTopDocumentsAsync(executor, i % 2 ? "curly"s : "funny"s, far_deadline));
+		}
+		for (size_t i = 0; i < in_flight.size(); ++i)
+		{
+			ASSERT_EQUAL(in_flight[i].Get().documents.size(), i % 2 ? 2 : 3);
+		}
+	}
+}
+
+// Статистика индекса: число термов и постингов, самые длинные списки и учёт памяти по структурам
+void TestIndexStats()
+{
+	using std::string_literals::operator""s;
+	SearchServer search_server("and with"s, SearchServerOptions{true});
+	{
+		const IndexStats empty = search_server.GetIndexStats();
+		ASSERT_EQUAL(empty.term_count, 0);
+		ASSERT_EQUAL(empty.posting_count, 0);
+		ASSERT(empty.longest_postings.empty());
+		ASSERT_EQUAL(empty.memory.postings, 0);
+		ASSERT_EQUAL(empty.memory.documents, 0);
+	}
+
+	search_server.AddDocument(1, "rat rat cat and dog"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(2, "rat cat bird"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(3, "rat with fish"s, DocumentStatus::ACTUAL, {3});
+	const IndexStats stats = search_server.GetIndexStats();
+	ASSERT_EQUAL(stats.document_count, 3);
+	ASSERT_EQUAL(stats.term_count, 5);
+	ASSERT_EQUAL(stats.posting_count, 8);
+	ASSERT(double_equals(stats.average_postings_per_document, 8.0 / 3));
+	ASSERT_EQUAL(stats.longest_postings.size(), 5);
+	ASSERT_EQUAL(stats.longest_postings[0].first, "rat"s);
+	ASSERT_EQUAL(stats.longest_postings[0].second, 3);
+	ASSERT_EQUAL(stats.longest_postings[1].first, "cat"s);
+	ASSERT_EQUAL(stats.longest_postings[1].second, 2);
+	ASSERT(stats.memory.dictionary > 0);
+	ASSERT(stats.memory.postings > 0);
+	ASSERT(stats.memory.forward_index > 0);
+	ASSERT(stats.memory.documents > 0);
+	ASSERT(stats.memory.positions > 0);
+
+	// перенос сервера не ломает учёт: счётчики переезжают вместе с контейнерами
+	SearchServer moved(std::move(search_server));
+	moved.RemoveDocument(1);
+	moved.RemoveDocument(2);
+	moved.RemoveDocument(3);
+	const IndexStats after_remove = moved.GetIndexStats();
+	ASSERT_EQUAL(after_remove.term_count, 0);
+	ASSERT_EQUAL(after_remove.posting_count, 0);
+	ASSERT(double_equals(after_remove.average_postings_per_document, 0));
+	ASSERT_EQUAL(after_remove.memory.documents, 0);
+	ASSERT_EQUAL(after_remove.memory.forward_index, 0);
+	ASSERT_EQUAL(after_remove.memory.positions, 0);
+	// термы из словаря не удаляются
+	ASSERT(after_remove.memory.dictionary >= stats.memory.dictionary);
+}
+
+// Режимы прямого индекса отвечают одинаково, отличаются только памятью и удалением
+void TestForwardIndexModes()
+{
+	using std::string_literals::operator""s;
+	const std::vector<std::string> texts = {
+		"funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+		"pet with rat and rat and rat"s, "nasty rat with curly hair"s, "big cat"s, "small dog"s, "big dog"s,
+	};
+	const auto make_server = [&texts](ForwardIndexMode mode) {
+		SearchServer search_server("and with"s, SearchServerOptions{false, mode});
+		for (size_t i = 0; i < texts.size(); ++i)
+		{
+			search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+		}
+		return search_server;
+	};
+	SearchServer full = make_server(ForwardIndexMode::FULL);
+	SearchServer compact = make_server(ForwardIndexMode::COMPACT);
+	SearchServer none = make_server(ForwardIndexMode::NONE);
+
+	const auto assert_same = [&full](const SearchServer& other) {
+		for (const std::string& query : {"nasty rat -not"s, "curly pet"s, "big dog"s})
+		{
+			const auto expected = full.FindTopDocuments(query);
+			const auto found = other.FindTopDocuments(query);
+			ASSERT_EQUAL(found.size(), expected.size());
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				ASSERT_EQUAL(found[i].id, expected[i].id);
+				ASSERT(double_equals(found[i].relevance, expected[i].relevance));
+			}
+		}
+		for (const int document_id : full)
+		{
+			ASSERT(other.MatchDocument("nasty curly -not"s, document_id) == full.MatchDocument("nasty curly -not"s, document_id));
+			ASSERT(other.GetWordFrequencies(document_id) == full.GetWordFrequencies(document_id));
+			ASSERT(other.GetAllWordsInDocument(document_id) == full.GetAllWordsInDocument(document_id));
+		}
+	};
+	assert_same(compact);
+	assert_same(none);
+	ASSERT(compact.GetIndexStats().memory.forward_index < full.GetIndexStats().memory.forward_index);
+	ASSERT_EQUAL(none.GetIndexStats().memory.forward_index, 0);
+
+	// без прямого индекса удаление оставляет постинги до чистки
+	full.RemoveDocument(5);
+	compact.RemoveDocument(5);
+	none.RemoveDocument(5);
+	ASSERT_EQUAL(none.GetIndexStats().removed_posting_count, 2);
+	ASSERT_EQUAL(compact.GetIndexStats().removed_posting_count, 0);
+	ASSERT(none.GetWordFrequencies(5).empty());
+	ASSERT(none.GetAllWordsInDocument(5).empty());
+	ASSERT(none.FindTopDocuments("cat"s).empty());
+	assert_same(compact);
+	none.Compact();
+	ASSERT_EQUAL(none.GetIndexStats().removed_posting_count, 0);
+	assert_same(none);
+
+	// повторное добавление id сначала вычищает старые постинги
+	full.RemoveDocument(6);
+	none.RemoveDocument(6);
+	full.AddDocument(6, "big fish"s, DocumentStatus::ACTUAL, {6});
+	none.AddDocument(6, "big fish"s, DocumentStatus::ACTUAL, {6});
+	ASSERT(none.FindTopDocuments("small"s).empty());
+	assert_same(none);
+
+	// при большой доле удалённых постингов Compact запускается сам
+	for (const int document_id : {0, 1, 2})
+	{
+		none.RemoveDocument(document_id);
+	}
+	ASSERT(none.GetIndexStats().removed_posting_count * 4 <= none.GetIndexStats().posting_count + 4);
+
+	// список удалённых растёт по числу удалённых документов, а не по величине id
+	{
+		SearchServer sparse("and with"s, SearchServerOptions{false, ForwardIndexMode::NONE});
+		for (int document_id = 0; document_id < 10; ++document_id)
+		{
+			sparse.AddDocument(document_id, "small cat"s, DocumentStatus::ACTUAL, {1});
+		}
+		sparse.AddDocument(2'000'000'000, "big dog"s, DocumentStatus::ACTUAL, {1});
+		const size_t documents_memory = sparse.GetIndexStats().memory.documents;
+		sparse.RemoveDocument(2'000'000'000);
+		ASSERT_EQUAL(sparse.GetIndexStats().removed_posting_count, 2);
+		ASSERT(sparse.GetIndexStats().memory.documents < documents_memory);
+		ASSERT(sparse.FindTopDocuments("dog"s).empty());
+	}
+
+	bool thrown = false;
+	try
+	{
+		SearchServer invalid("and"s, SearchServerOptions{true, ForwardIndexMode::NONE});
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	ASSERT(thrown);
+}
+
 string GenerateWord(mt19937& generator, int max_length)
 {
 	const int length = uniform_int_distribution(1, max_length)(generator);
@@ -728,6 +1176,7 @@ void ParralelFind()
 		LOG_DURATION("PAR");
 		Test("par"s, search_server, queries, std::execution::par);
 	}
+	profile::Report(cout);
 
 }
 
@@ -788,6 +1237,21 @@ void TestSearchServer()
 //	RUN_TEST(ParralelMatch);
 	// 27
 	RUN_TEST(ParralelFind);
+	RUN_TEST(TestProfileHistograms);
+	// 28
+	RUN_TEST(TestBm25Ranking);
+	// 29
+	RUN_TEST(TestMatchDocumentTermIds);
+	// 30
+	RUN_TEST(TestPhraseQueries);
+	// 31
+	RUN_TEST(TestPrefixQueries);
+	// 32
+	RUN_TEST(TestAsyncFindTopDocuments);
+	// 33
+	RUN_TEST(TestIndexStats);
+	// 34
+	RUN_TEST(TestForwardIndexModes);
 }
 
 int main()
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Сколько байт сейчас выделено под одну структуру и сколько живых выделений.
+// Считаются запрошенные контейнером байты, без служебных заголовков malloc
+struct MemoryCounter
+{
+	std::atomic<int64_t> bytes{0};
+	std::atomic<int64_t> allocations{0};
+};
+
+// std::allocator, который ведёт учёт в MemoryCounter. Счётчик переезжает вместе с контейнером
+// при переносе и обмене. Аллокатор по умолчанию (без счётчика) ничего не считает
+template <typename T> class CountingAllocator
+{
+  public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	CountingAllocator() noexcept = default;
+
+	explicit CountingAllocator(MemoryCounter* counter) noexcept : counter_(counter)
+	{
+	}
+
+	template <typename U> CountingAllocator(const CountingAllocator<U>& other) noexcept : counter_(other.GetCounter())
+	{
+	}
+
+	T* allocate(size_t n)
+	{
+		T* result = std::allocator<T>().allocate(n);
+		if (counter_)
+		{
+			counter_->bytes.fetch_add(static_cast<int64_t>(n * sizeof(T)), std::memory_order_relaxed);
+			counter_->allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	void deallocate(T* pointer, size_t n) noexcept
+	{
+		if (counter_)
+		{
+			counter_->bytes.fetch_sub(static_cast<int64_t>(n * sizeof(T)), std::memory_order_relaxed);
+			counter_->allocations.fetch_sub(1, std::memory_order_relaxed);
+		}
+		std::allocator<T>().deallocate(pointer, n);
+	}
+
+	MemoryCounter* GetCounter() const noexcept
+	{
+		return counter_;
+	}
+
+	template <typename U> bool operator==(const CountingAllocator<U>& other) const noexcept
+	{
+		return counter_ == other.GetCounter();
+	}
+
+	template <typename U> bool operator!=(const CountingAllocator<U>& other) const noexcept
+	{
+		return !(*this == other);
+	}
+
+  private:
+	MemoryCounter* counter_ = nullptr;
+};
+
+// Владелец набора счётчиков для объекта с контейнерами на CountingAllocator. При переносе
+// счётчики не передаются, а делятся: контейнеры, оставшиеся в перенесённом объекте, могут
+// освобождать память и после того, как новый владелец уничтожен
+template <typename Counters> class SharedCounters
+{
+  public:
+	SharedCounters() : counters_(std::make_shared<Counters>())
+	{
+	}
+
+	SharedCounters(const SharedCounters&) = default;
+
+	SharedCounters(SharedCounters&& other) noexcept : counters_(other.counters_)
+	{
+	}
+
+	Counters* operator->() const noexcept
+	{
+		return counters_.get();
+	}
+
+  private:
+	std::shared_ptr<Counters> counters_;
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+using CountedMap = std::map<Key, Value, Compare, CountingAllocator<std::pair<const Key, Value>>>;
+
+template <typename Key, typename Compare = std::less<Key>>
+using CountedSet = std::set<Key, Compare, CountingAllocator<Key>>;
+
+template <typename T> using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
@@ -0,0 +1,54 @@
+#include "query_executor.h"
+
+#include <algorithm>
+
+QueryExecutor::QueryExecutor(size_t thread_count)
+{
+	thread_count = std::max<size_t>(thread_count, 1);
+	workers_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		workers_.emplace_back([this] { Work(); });
+	}
+}
+
+QueryExecutor::~QueryExecutor()
+{
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	cv_.notify_all();
+	for (auto& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+void QueryExecutor::Post(std::coroutine_handle<> handle)
+{
+	{
+		std::lock_guard guard(mutex_);
+		queue_.push_back(handle);
+	}
+	cv_.notify_one();
+}
+
+void QueryExecutor::Work()
+{
+	while (true)
+	{
+		std::coroutine_handle<> handle;
+		{
+			std::unique_lock lock(mutex_);
+			cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+			if (queue_.empty())
+			{
+				return;
+			}
+			handle = queue_.front();
+			queue_.pop_front();
+		}
+		handle.resume();
+	}
+}
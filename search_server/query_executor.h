@@ -0,0 +1,125 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Общий пул потоков для корутин-запросов. Корутина не занимает поток целиком:
+// на каждом co_await Yield() она встаёт в конец очереди, и тысячи запросов
+// делят между собой несколько потоков.
+class QueryExecutor
+{
+  public:
+	explicit QueryExecutor(size_t thread_count = std::thread::hardware_concurrency());
+
+	QueryExecutor(const QueryExecutor&) = delete;
+	QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+	// Дожидается, пока очередь опустеет, и останавливает потоки
+	~QueryExecutor();
+
+	void Post(std::coroutine_handle<> handle);
+
+	// co_await executor.Schedule() - продолжить корутину в потоке пула
+	auto Schedule()
+	{
+		struct Awaiter
+		{
+			QueryExecutor& executor;
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				executor.Post(handle);
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+		return Awaiter{*this};
+	}
+
+	// Уступить поток другим запросам: то же, что Schedule, но по смыслу - точка переключения
+	auto Yield()
+	{
+		return Schedule();
+	}
+
+  private:
+	void Work();
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::coroutine_handle<>> queue_;
+	bool stopping_ = false;
+	std::vector<std::thread> workers_;
+};
+
+// Результат корутины в виде std::future: корутина стартует сразу, после первого
+// co_await продолжается в пуле, а вызывающий ждёт через Get/WaitFor или забирает future.
+template <typename T> class QueryFuture
+{
+  public:
+	struct promise_type
+	{
+		std::promise<T> promise;
+
+		QueryFuture get_return_object()
+		{
+			return QueryFuture(promise.get_future());
+		}
+
+		std::suspend_never initial_suspend() const noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend() const noexcept
+		{
+			return {};
+		}
+
+		void return_value(T value)
+		{
+			promise.set_value(std::move(value));
+		}
+
+		void unhandled_exception()
+		{
+			promise.set_exception(std::current_exception());
+		}
+	};
+
+	T Get()
+	{
+		return future_.get();
+	}
+
+	template <typename Rep, typename Period> bool WaitFor(std::chrono::duration<Rep, Period> timeout) const
+	{
+		return future_.wait_for(timeout) == std::future_status::ready;
+	}
+
+	std::future<T> TakeFuture()
+	{
+		return std::move(future_);
+	}
+
+  private:
+	explicit QueryFuture(std::future<T> future) : future_(std::move(future))
+	{
+	}
+
+	std::future<T> future_;
+};
@@ -1,12 +1,63 @@
 // source
 #include "search_server.h"
+#include "varint.h"
 
 #include <cmath>
+#include <optional>
 
 using namespace std;
 
-SearchServer::SearchServer(const string& stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text)) // Invoke delegating constructor from string container
+namespace
+{
+	// Возрастающие позиции пишем дельтами в varint
+	template <typename ByteVector> void EncodePositions(const std::vector<int>& positions, ByteVector& out)
+	{
+		int previous = -1;
+		for (const int position : positions)
+		{
+			WriteVarint(out, static_cast<uint32_t>(position - previous));
+			previous = position;
+		}
+	}
+
+	std::vector<int> DecodePositions(const uint8_t* first, const uint8_t* last)
+	{
+		std::vector<int> positions;
+		int previous = -1;
+		while (first != last)
+		{
+			previous += static_cast<int>(ReadVarint(first));
+			positions.push_back(previous);
+		}
+		return positions;
+	}
+
+	// Снимает кавычку, закрывающую фразу: cat" или cat"~2. Возвращает slop, если кавычка была
+	std::optional<int> StripPhraseEnd(std::string_view& word)
+	{
+		const size_t quote = word.rfind('"');
+		if (quote == std::string_view::npos)
+		{
+			return std::nullopt;
+		}
+		std::string_view suffix = word.substr(quote + 1);
+		int slop = 0;
+		if (!suffix.empty())
+		{
+			if (suffix[0] != '~' || suffix.size() == 1 ||
+				!std::all_of(suffix.begin() + 1, suffix.end(), [](char c) { return c >= '0' && c <= '9'; }))
+			{
+				throw std::invalid_argument("Invalid phrase suffix " + std::string(suffix));
+			}
+			slop = std::stoi(std::string(suffix.substr(1)));
+		}
+		word = word.substr(0, quote);
+		return slop;
+	}
+} // namespace
+
+SearchServer::SearchServer(const string& stop_words_text, SearchServerOptions options)
+	: SearchServer(SplitIntoWords(stop_words_text), options) // Invoke delegating constructor from string container
 {
 }
 
@@ -17,15 +68,82 @@ void SearchServer::AddDocument(int document_id, std::string_view document, Docum
 	{
 		throw invalid_argument("Invalid document_id"s);
 	}
+	if (IsRemoved(document_id))
+	{
+		// старые постинги документа с тем же id иначе смешались бы с новыми
+		Compact();
+	}
 	const auto words = SplitIntoWordsNoStop(document);
 
 	const double inv_word_count = 1.0 / words.size();
+	CountedVector<int> term_ids{CountingAllocator<int>(&memory_->forward_index)};
+	term_ids.reserve(words.size());
+	// вложенным контейнерам аллокатор со счётчиком передаётся явно: operator[] создал бы их без учёта
+	DocumentWords* document_words = nullptr;
+	if (options_.forward_index == ForwardIndexMode::FULL)
+	{
+		document_words =
+			&document_to_word_freqs_.try_emplace(document_id, DocumentWords::allocator_type(&memory_->forward_index))
+				 .first->second;
+	}
 	for (const auto& word : words)
 	{
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		document_to_word_freqs_[document_id][word] += inv_word_count;
+		const int term_id = GetOrAddTermId(word);
+		const std::string_view term = terms_[term_id];
+		word_to_document_freqs_.try_emplace(term, PostingList::allocator_type(&memory_->postings))
+			.first->second[document_id] += inv_word_count;
+		if (document_words)
+		{
+			(*document_words)[term] += inv_word_count;
+		}
+		term_ids.push_back(term_id);
+	}
+	if (options_.store_positions)
+	{
+		// позиция считается по всем словам текста, стоп-слова оставляют пропуск
+		std::vector<std::pair<int, int>> term_positions;
+		term_positions.reserve(words.size());
+		int position = 0;
+		size_t word_index = 0;
+		for (std::string_view word : SplitIntoWords(document))
+		{
+			if (!IsStopWord(word))
+			{
+				term_positions.emplace_back(term_ids[word_index++], position);
+			}
+			++position;
+		}
+		std::sort(term_positions.begin(), term_positions.end());
+
+		DocumentPositions& document_positions =
+			document_positions_.try_emplace(document_id, memory_->positions).first->second;
+		std::vector<int> positions;
+		for (size_t i = 0; i < term_positions.size(); ++i)
+		{
+			positions.push_back(term_positions[i].second);
+			if (i + 1 == term_positions.size() || term_positions[i + 1].first != term_positions[i].first)
+			{
+				document_positions.offsets.push_back(static_cast<uint32_t>(document_positions.data.size()));
+				EncodePositions(positions, document_positions.data);
+				positions.clear();
+			}
+		}
+		document_positions.offsets.push_back(static_cast<uint32_t>(document_positions.data.size()));
+		document_positions.data.shrink_to_fit();
+	}
+
+	std::sort(term_ids.begin(), term_ids.end());
+	term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+	term_ids.shrink_to_fit();
+	const int term_count = static_cast<int>(term_ids.size());
+	posting_count_ += term_count;
+	if (options_.forward_index != ForwardIndexMode::NONE)
+	{
+		document_term_ids_.emplace(document_id, std::move(term_ids));
 	}
-	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status,
+												 static_cast<int>(words.size()), term_count});
+	total_word_count_ += words.size();
 	document_ids_.insert(document_id);
 }
 
@@ -41,6 +159,16 @@ vector<Document> SearchServer::FindTopDocuments(const string_view raw_query) con
 	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, RankingFunction ranking) const
+{
+	return FindTopDocuments(
+		std::execution::seq, raw_query,
+		[](int, DocumentStatus document_status, int) {
+			return document_status == DocumentStatus::ACTUAL;
+		},
+		ranking);
+}
+
 int SearchServer::GetDocumentCount() const
 {
 	return documents_.size();
@@ -53,16 +181,9 @@ void SearchServer::RemoveDocument(int document_id)
 
 const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
 {
-	static std::map<std::string_view, double> empty_map;
-	if (document_to_word_freqs_.count(document_id) == 0)
-	{
-		return empty_map;
-	}
 	static std::map<std::string_view, double> map_;
-	for (const auto& doc : document_to_word_freqs_.at(document_id))
-	{
-		map_[doc.first] = doc.second;
-	}
+	map_.clear();
+	ForEachDocumentTerm(document_id, [](std::string_view term, double term_freq) { map_[term] = term_freq; });
 	return map_;
 }
 
@@ -72,6 +193,170 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 	return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocumentTermIds(
+	std::string_view raw_query, int document_id) const
+{
+	const auto status = documents_.at(document_id).status;
+	QueryTermIds query;
+	if (raw_query.find_first_of("\"*") == std::string_view::npos)
+	{
+		query = ParseQueryTermIds(raw_query);
+	}
+	else
+	{
+		// фразы и префиксы разбираются полным ParseQuery;
+		// фраза, которой нет в документе, делает его несовпавшим, как и в FindTopDocuments
+		const Query full_query = ParseQuery(raw_query);
+		if (!MatchesPhrases(document_id, full_query.phrases))
+		{
+			return {std::vector<std::string_view>{}, status};
+		}
+		query = ToTermIds(full_query);
+	}
+	// с прямым индексом - пересечение с id термов документа, без него - поиск документа в постингах
+	const auto document_ids = document_term_ids_.find(document_id);
+	const auto intersect = [this, document_id, &document_ids](const std::vector<int>& ids, auto on_match) {
+		if (document_ids != document_term_ids_.end())
+		{
+			GallopingIntersect(ids.begin(), ids.end(), document_ids->second.begin(), document_ids->second.end(),
+							   on_match);
+			return;
+		}
+		for (const int term_id : ids)
+		{
+			if (word_to_document_freqs_.find(terms_[term_id])->second.count(document_id) > 0)
+			{
+				on_match(term_id);
+			}
+		}
+	};
+
+	bool has_minus_word = false;
+	intersect(query.minus_ids, [&has_minus_word](int) { has_minus_word = true; });
+	if (has_minus_word)
+	{
+		return {std::vector<std::string_view>{}, status};
+	}
+
+	std::vector<std::string_view> matched_words;
+	intersect(query.plus_ids, [this, &matched_words](int term_id) { matched_words.push_back(terms_[term_id]); });
+	// порядок как у прежней реализации - по словам, а не по id
+	std::sort(matched_words.begin(), matched_words.end());
+	return {matched_words, status};
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+	if (std::abs(lhs.relevance - rhs.relevance) < 1e-6)
+	{
+		return lhs.rating > rhs.rating;
+	}
+	else
+	{
+		return lhs.relevance > rhs.relevance;
+	}
+}
+
+QueryFuture<AsyncSearchResult> SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+																   std::chrono::steady_clock::time_point deadline,
+																   std::stop_token stop_token, RankingFunction ranking,
+																   DocumentStatus status) const
+{
+	co_await executor.Schedule();
+
+	const auto interrupted = [&deadline, &stop_token] {
+		return stop_token.stop_requested() || std::chrono::steady_clock::now() >= deadline;
+	};
+
+	const Query query = ParseQuery(raw_query);
+
+	// минус-слова применяются целиком, иначе частичный ответ мог бы содержать исключённые документы
+	std::set<int> excluded;
+	for (const std::string& word : query.minus_words)
+	{
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end())
+		{
+			for (const auto& [document_id, _] : it->second)
+			{
+				excluded.insert(document_id);
+			}
+		}
+	}
+
+	// от редких слов к частым: у редких больше idf, частичный top-K ближе к полному
+	std::vector<const decltype(word_to_document_freqs_)::value_type*> postings;
+	for (const std::string& word : query.plus_words)
+	{
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end())
+		{
+			postings.push_back(&*it);
+		}
+	}
+	std::sort(postings.begin(), postings.end(),
+			  [](const auto* lhs, const auto* rhs) { return lhs->second.size() < rhs->second.size(); });
+
+	const TfIdfScorer tf_idf{*this};
+	const Bm25Scorer bm25(*this);
+	std::map<int, double> document_to_relevance;
+	bool complete = true;
+	for (const auto* word_postings : postings)
+	{
+		const std::string_view word = word_postings->first;
+		const double word_weight = ranking == RankingFunction::BM25 ? bm25.WordWeight(word) : tf_idf.WordWeight(word);
+		auto it = word_postings->second.begin();
+		while (it != word_postings->second.end())
+		{
+			if (interrupted())
+			{
+				complete = false;
+				break;
+			}
+			// скорер выбирается на порцию, внутри порции - прямой вызов
+			const auto accumulate = [&](const auto& scorer) {
+				for (size_t i = 0; i < ASYNC_POSTINGS_CHUNK && it != word_postings->second.end(); ++i, ++it)
+				{
+					const auto [document_id, term_freq] = *it;
+					const auto document_it = documents_.find(document_id);
+					if (document_it != documents_.end() && document_it->second.status == status)
+					{
+						document_to_relevance[document_id] += scorer(word_weight, term_freq, document_it->second);
+					}
+				}
+			};
+			if (ranking == RankingFunction::BM25)
+			{
+				accumulate(bm25);
+			}
+			else
+			{
+				accumulate(tf_idf);
+			}
+			co_await executor.Yield();
+		}
+		if (!complete)
+		{
+			break;
+		}
+	}
+
+	AsyncSearchResult result;
+	result.complete = complete;
+	for (const auto& [document_id, relevance] : document_to_relevance)
+	{
+		if (excluded.count(document_id) == 0 && MatchesPhrases(document_id, query.phrases))
+		{
+			result.documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+		}
+	}
+	const size_t top_size = std::min<size_t>(result.documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+	std::partial_sort(result.documents.begin(), result.documents.begin() + top_size, result.documents.end(),
+					  IsMoreRelevant);
+	result.documents.resize(top_size);
+	co_return result;
+}
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings)
 {
 	if (ratings.empty())
@@ -110,9 +395,66 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 SearchServer::Query SearchServer::ParseQuery(std::string_view text) const
 {
 	Query result;
+	std::optional<Phrase> phrase;
+	int phrase_position = 0;
 	const auto word_vector = SplitIntoWords(text);
 	for (std::string_view word : word_vector)
 	{
+		if (!phrase && word.size() > 1 && word[0] == '-' && word[1] == '"')
+		{
+			throw std::invalid_argument("Minus phrases are not supported");
+		}
+		if (!phrase && !word.empty() && word[0] == '"')
+		{
+			if (!options_.store_positions)
+			{
+				throw std::invalid_argument("Phrase queries require SearchServerOptions::store_positions");
+			}
+			phrase.emplace();
+			phrase_position = 0;
+			word.remove_prefix(1);
+		}
+		if (phrase)
+		{
+			const std::optional<int> slop = StripPhraseEnd(word);
+			const auto query_word = ParseQueryWord(word);
+			if (query_word.is_minus)
+			{
+				throw std::invalid_argument("Minus words are not allowed inside a phrase");
+			}
+			if (!query_word.data.empty() && query_word.data.back() == '*')
+			{
+				throw std::invalid_argument("Prefix words are not allowed inside a phrase");
+			}
+			if (!query_word.is_stop)
+			{
+				phrase->words.emplace_back(query_word.data);
+				phrase->offsets.push_back(phrase_position);
+				result.plus_words.emplace(query_word.data);
+			}
+			++phrase_position;
+			if (slop)
+			{
+				phrase->slop = *slop;
+				if (!phrase->words.empty())
+				{
+					result.phrases.push_back(std::move(*phrase));
+				}
+				phrase.reset();
+			}
+			continue;
+		}
+
+		if (word.size() > 1 && word.back() == '*')
+		{
+			// prefix* раскрывается в термы словаря и дальше ранжируется как обычные слова
+			const auto query_word = ParseQueryWord(word.substr(0, word.size() - 1));
+			auto& target = query_word.is_minus ? result.minus_words : result.plus_words;
+			ForEachTermWithPrefix(query_word.data, MAX_PREFIX_EXPANSION,
+								  [&target](std::string_view term) { target.emplace(term); });
+			continue;
+		}
+
 		auto query_word = ParseQueryWord(word);
 		if (!query_word.is_stop)
 		{
@@ -126,41 +468,288 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text) const
 			}
 		}
 	}
+	if (phrase)
+	{
+		throw std::invalid_argument("Phrase quote is not closed");
+	}
 	return result;
 }
 
+SearchServer::QueryTermIds SearchServer::ParseQueryTermIds(std::string_view text) const
+{
+	QueryTermIds result;
+	for (std::string_view word : SplitIntoWords(text))
+	{
+		const auto query_word = ParseQueryWord(word);
+		if (query_word.is_stop)
+		{
+			continue;
+		}
+		const auto it = term_ids_.find(query_word.data);
+		if (it == term_ids_.end())
+		{
+			continue;
+		}
+		(query_word.is_minus ? result.minus_ids : result.plus_ids).push_back(it->second);
+	}
+	for (auto* ids : {&result.plus_ids, &result.minus_ids})
+	{
+		std::sort(ids->begin(), ids->end());
+		ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+	}
+	return result;
+}
+
+SearchServer::QueryTermIds SearchServer::ToTermIds(const Query& query) const
+{
+	QueryTermIds result;
+	const auto to_ids = [this](const auto& words, std::vector<int>& ids) {
+		for (const std::string& word : words)
+		{
+			const auto it = term_ids_.find(word);
+			if (it != term_ids_.end())
+			{
+				ids.push_back(it->second);
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+	};
+	to_ids(query.plus_words, result.plus_ids);
+	to_ids(query.minus_words, result.minus_ids);
+	return result;
+}
+
+std::vector<int> SearchServer::GetTermPositions(int document_id, int term_id) const
+{
+	const auto positions_it = document_positions_.find(document_id);
+	if (positions_it == document_positions_.end())
+	{
+		return {};
+	}
+	const auto& term_ids = document_term_ids_.at(document_id);
+	const auto term_it = std::lower_bound(term_ids.begin(), term_ids.end(), term_id);
+	if (term_it == term_ids.end() || *term_it != term_id)
+	{
+		return {};
+	}
+	const auto& [offsets, data] = positions_it->second;
+	const size_t index = term_it - term_ids.begin();
+	return DecodePositions(data.data() + offsets[index], data.data() + offsets[index + 1]);
+}
+
+bool SearchServer::MatchesPhrase(int document_id, const Phrase& phrase) const
+{
+	// позиции каждого слова, сдвинутые на его смещение во фразе:
+	// точная фраза - общий элемент всех списков
+	std::vector<std::vector<int>> shifted(phrase.words.size());
+	for (size_t i = 0; i < phrase.words.size(); ++i)
+	{
+		const auto term_it = term_ids_.find(phrase.words[i]);
+		if (term_it == term_ids_.end())
+		{
+			return false;
+		}
+		shifted[i] = GetTermPositions(document_id, term_it->second);
+		if (shifted[i].empty())
+		{
+			return false;
+		}
+		for (int& position : shifted[i])
+		{
+			position -= phrase.offsets[i];
+		}
+	}
+
+	if (phrase.slop == 0)
+	{
+		// начинаем с самого короткого списка, остальные пересекаем с ним галопом
+		std::sort(shifted.begin(), shifted.end(),
+				  [](const auto& lhs, const auto& rhs) { return lhs.size() < rhs.size(); });
+		std::vector<int> candidates = std::move(shifted[0]);
+		for (size_t i = 1; i < shifted.size() && !candidates.empty(); ++i)
+		{
+			std::vector<int> next;
+			GallopingIntersect(candidates.begin(), candidates.end(), shifted[i].begin(), shifted[i].end(),
+							   [&next](int position) { next.push_back(position); });
+			candidates = std::move(next);
+		}
+		return !candidates.empty();
+	}
+
+	// со slop слова идут в порядке фразы, суммарный лишний разрыв не больше slop;
+	// жадно берём ближайшую подходящую позицию следующего слова
+	for (const int start : shifted[0])
+	{
+		int previous = start;
+		int used_slop = 0;
+		bool matched = true;
+		for (size_t i = 1; i < shifted.size(); ++i)
+		{
+			const auto it = GallopLowerBound(shifted[i].begin(), shifted[i].end(), previous);
+			if (it == shifted[i].end())
+			{
+				return false;
+			}
+			used_slop += *it - previous;
+			if (used_slop > phrase.slop)
+			{
+				matched = false;
+				break;
+			}
+			previous = *it;
+		}
+		if (matched)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SearchServer::MatchesPhrases(int document_id, const std::vector<Phrase>& phrases) const
+{
+	return std::all_of(phrases.begin(), phrases.end(),
+					   [this, document_id](const Phrase& phrase) { return MatchesPhrase(document_id, phrase); });
+}
+
+int SearchServer::GetOrAddTermId(std::string_view word)
+{
+	const auto it = term_ids_.find(word);
+	if (it != term_ids_.end())
+	{
+		return it->second;
+	}
+	const int term_id = static_cast<int>(terms_.size());
+	term_ids_.emplace(terms_.emplace_back(word, CountingAllocator<char>(&memory_->dictionary)), term_id);
+	return term_id;
+}
+
 // Existence required
 double SearchServer::ComputeWordInverseDocumentFreq(const string_view word) const
 {
 	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
 }
 
+// Средняя длина документа берётся на момент запроса, поэтому на постинг остаётся
+// одно умножение-сложение в знаменателе и деление
+SearchServer::Bm25Scorer::Bm25Scorer(const SearchServer& search_server) : server(search_server)
+{
+	const double average_length =
+		search_server.documents_.empty()
+			? 1.0
+			: static_cast<double>(search_server.total_word_count_) / search_server.documents_.size();
+	norm_base = BM25_K1 * (1 - BM25_B);
+	norm_slope = BM25_K1 * BM25_B / average_length;
+}
+
+// Existence required
+double SearchServer::Bm25Scorer::WordWeight(const string_view word) const
+{
+	const double document_count = server.GetDocumentCount();
+	const double word_document_count = server.word_to_document_freqs_.at(word).size();
+	// (k1 + 1) из числителя BM25 внесён в вес слова
+	return log((document_count - word_document_count + 0.5) / (word_document_count + 0.5) + 1.0) * (BM25_K1 + 1);
+}
+
 std::set<std::string_view> SearchServer::GetAllWordsInDocument(const int document_id) const
 {
 	std::set<std::string_view> result;
-	for (const auto & item : word_to_document_freqs_)
+	ForEachDocumentTerm(document_id, [&result](std::string_view term, double) { result.insert(term); });
+	return result;
+}
+
+std::vector<std::string_view> SearchServer::FindTermsByPrefix(std::string_view prefix, size_t limit) const
+{
+	std::vector<std::string_view> result;
+	ForEachTermWithPrefix(prefix, limit, [&result](std::string_view term) { result.push_back(term); });
+	return result;
+}
+
+bool SearchServer::IsRemoved(int document_id) const
+{
+	return std::binary_search(removed_documents_.begin(), removed_documents_.end(), document_id);
+}
+
+void SearchServer::MarkRemoved(int document_id, int term_count)
+{
+	removed_documents_.insert(std::lower_bound(removed_documents_.begin(), removed_documents_.end(), document_id),
+							  document_id);
+	removed_posting_count_ += term_count;
+	if (removed_posting_count_ > COMPACTION_REMOVED_POSTINGS_SHARE * (posting_count_ + removed_posting_count_))
+	{
+		Compact();
+	}
+}
+
+void SearchServer::Compact()
+{
+	if (removed_posting_count_ == 0)
 	{
-		if (item.second.find(document_id) != item.second.end())
+		return;
+	}
+	for (auto& [term, postings] : word_to_document_freqs_)
+	{
+		std::erase_if(postings, [this](const auto& posting) { return IsRemoved(posting.first); });
+	}
+	removed_documents_.clear();
+	removed_documents_.shrink_to_fit();
+	removed_posting_count_ = 0;
+}
+
+IndexStats SearchServer::GetIndexStats() const
+{
+	IndexStats stats;
+	stats.document_count = documents_.size();
+	stats.posting_count = static_cast<size_t>(posting_count_);
+	stats.removed_posting_count = static_cast<size_t>(removed_posting_count_);
+	stats.average_postings_per_document =
+		documents_.empty() ? 0.0 : static_cast<double>(posting_count_) / documents_.size();
+
+	// куча из INDEX_STATS_TOP_POSTINGS самых длинных списков, наверху самый короткий из них
+	const auto longer = [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; };
+	auto& top = stats.longest_postings;
+	for (const auto& [term, postings] : word_to_document_freqs_)
+	{
+		if (postings.empty())
 		{
-			result.insert(item.first);
 			continue;
 		}
+		++stats.term_count;
+		if (top.size() < INDEX_STATS_TOP_POSTINGS)
+		{
+			top.emplace_back(term, postings.size());
+			std::push_heap(top.begin(), top.end(), longer);
+		}
+		else if (postings.size() > top.front().second)
+		{
+			std::pop_heap(top.begin(), top.end(), longer);
+			top.back() = {term, postings.size()};
+			std::push_heap(top.begin(), top.end(), longer);
+		}
 	}
-	return result;
+	std::sort_heap(top.begin(), top.end(), longer);
+
+	const auto bytes = [](const MemoryCounter& counter) { return counter.bytes.load(std::memory_order_relaxed); };
+	stats.memory.dictionary = bytes(memory_->dictionary) + static_cast<int64_t>(term_dictionary_.ByteSize());
+	stats.memory.postings = bytes(memory_->postings);
+	stats.memory.forward_index = bytes(memory_->forward_index);
+	stats.memory.documents = bytes(memory_->documents);
+	stats.memory.positions = bytes(memory_->positions);
+	return stats;
 }
 
-std::set<int>::const_iterator SearchServer::begin() const
+CountedSet<int>::const_iterator SearchServer::begin() const
 {
 	return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const
+CountedSet<int>::const_iterator SearchServer::end() const
 {
 	return document_ids_.end();
 }
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-	: SearchServer(SplitIntoWords(std::string(stop_words_text)))
+SearchServer::SearchServer(std::string_view stop_words_text, SearchServerOptions options)
+	: SearchServer(SplitIntoWords(std::string(stop_words_text)), options)
 {
 }
 
@@ -183,7 +772,7 @@ std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_vie
 
 bool SearchServer::IsStopWord(std::string_view word) const
 {
-	return stop_words_.count(std::string(word)) > 0;
+	return stop_words_.count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(std::string_view word)
@@ -4,32 +4,137 @@
 #include "string_processing.h"
 
 #include "concurrent_map.h"
+#include "memory_accounting.h"
+#include "query_executor.h"
+#include "sorted_intersection.h"
+#include "term_dictionary.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <execution>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <vector>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+// Сколько термов максимум подставляется вместо одного префиксного слова prefix*
+const size_t MAX_PREFIX_EXPANSION = 64;
+// Сколько постингов асинхронный запрос обрабатывает между точками переключения
+const size_t ASYNC_POSTINGS_CHUNK = 4096;
+// Сколько самых длинных списков постингов попадает в IndexStats
+const size_t INDEX_STATS_TOP_POSTINGS = 10;
+// Без прямого индекса удалённые документы остаются в постингах; когда их доля
+// среди постингов превышает этот порог, RemoveDocument запускает Compact
+const double COMPACTION_REMOVED_POSTINGS_SHARE = 0.25;
+
+// Какой прямой индекс (документ -> термы) хранит сервер
+enum class ForwardIndexMode
+{
+	// отсортированные id термов и частоты по документу: все методы работают быстро
+	FULL,
+	// только отсортированные id термов; частоты GetWordFrequencies берутся из постингов
+	COMPACT,
+	// прямого индекса нет: GetWordFrequencies и GetAllWordsInDocument обходят весь обратный индекс,
+	// удаление заносит id в список удалённых, постинги чистит Compact. До чистки
+	// удалённые документы учитываются в idf слов
+	NONE
+};
+
+// Настройки, задаваемые при создании сервера
+struct SearchServerOptions
+{
+	// Хранить позиции слов (сжатые списки на документ): нужны фразовым запросам "a b" и "a b"~N.
+	// Без них позиционный индекс не строится и память на него не тратится
+	bool store_positions = false;
+	// Позициям нужны id термов документа, поэтому store_positions несовместим с NONE
+	ForwardIndexMode forward_index = ForwardIndexMode::FULL;
+};
+
+// Функция ранжирования выбирается на каждый запрос
+enum class RankingFunction
+{
+	TF_IDF,
+	BM25
+};
+
+// complete == false: запрос прерван дедлайном или отменой, documents - лучшие
+// из документов, подсчитанных к этому моменту
+struct AsyncSearchResult
+{
+	std::vector<Document> documents;
+	bool complete = true;
+};
+
+// Байты, выделенные под каждую структуру индекса (по счётчикам CountingAllocator)
+struct IndexMemoryUsage
+{
+	// строки термов, их id и сжатый словарь для префиксных запросов
+	int64_t dictionary = 0;
+	// обратный индекс: терм -> документы
+	int64_t postings = 0;
+	// прямой индекс: документ -> термы
+	int64_t forward_index = 0;
+	// рейтинги, статусы и множество id документов
+	int64_t documents = 0;
+	// позиции слов (только при store_positions)
+	int64_t positions = 0;
+
+	int64_t Total() const
+	{
+		return dictionary + postings + forward_index + documents + positions;
+	}
+};
+
+// Статистика для планирования ёмкости. Счётчики памяти и постингов читаются за O(1),
+// самые длинные списки ищутся одним проходом по словарю, без копирования постингов.
+// Без прямого индекса длины списков до Compact включают удалённые документы
+struct IndexStats
+{
+	size_t document_count = 0;
+	// термы, у которых остался хотя бы один документ
+	size_t term_count = 0;
+	// пары (терм, документ) в обратном индексе
+	size_t posting_count = 0;
+	// постинги удалённых документов, которые ещё не вычистил Compact
+	size_t removed_posting_count = 0;
+	double average_postings_per_document = 0;
+	// не больше INDEX_STATS_TOP_POSTINGS термов по убыванию длины списка
+	std::vector<std::pair<std::string_view, size_t>> longest_postings;
+	IndexMemoryUsage memory;
+};
 
 class SearchServer
 {
   public:
 	template <typename StringContainer>
-	explicit SearchServer(const StringContainer& stop_words)
-		: stop_words_(MakeUniqueNonEmptyStrings<StringContainer>(stop_words))
+	explicit SearchServer(const StringContainer& stop_words, SearchServerOptions options = {})
+		: stop_words_(MakeUniqueNonEmptyStrings<StringContainer>(stop_words)), options_(options)
 	{
 		if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
 		{
 			throw std::invalid_argument("Some of stop words are invalid");
 		}
+		if (options_.store_positions && options_.forward_index == ForwardIndexMode::NONE)
+		{
+			throw std::invalid_argument("Positions require a forward index");
+		}
 	}
 
-	explicit SearchServer(const std::string& stop_words_text);
+	explicit SearchServer(const std::string& stop_words_text, SearchServerOptions options = {});
+
+	explicit SearchServer(std::string_view stop_words_text, SearchServerOptions options = {});
 
-	explicit SearchServer(std::string_view stop_words_text);
+	// Индексы ссылаются на строки словаря внутри сервера: копия ссылалась бы на чужие строки
+	SearchServer(const SearchServer&) = delete;
+	SearchServer& operator=(const SearchServer&) = delete;
+	SearchServer(SearchServer&&) = default;
 
 	void AddDocument(int document_id, const std::string_view document, DocumentStatus status,
 					 const std::vector<int>& ratings);
@@ -42,13 +147,28 @@ class SearchServer
 
 	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, RankingFunction ranking) const;
+
 	template <typename ExecutionPolicy, typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy execution_policy, const std::string_view raw_query,
 										   DocumentPredicate document_predicate) const;
 
+	template <typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy execution_policy, const std::string_view raw_query,
+										   DocumentPredicate document_predicate, RankingFunction ranking) const;
+
 	template <typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy execution_policy, const std::string_view raw_query) const;
 
+	// Корутина на общем пуле executor. Слова обрабатываются от редких к частым, порциями по
+	// ASYNC_POSTINGS_CHUNK постингов; между порциями запрос уступает поток и проверяет дедлайн
+	// и отмену. Сервер и executor должны пережить запрос, индекс в это время не меняется.
+	QueryFuture<AsyncSearchResult> FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+														 std::chrono::steady_clock::time_point deadline,
+														 std::stop_token stop_token = {},
+														 RankingFunction ranking = RankingFunction::TF_IDF,
+														 DocumentStatus status = DocumentStatus::ACTUAL) const;
+
 	template <typename ExecutionPolicy>
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy,
 																			std::string_view raw_query,
@@ -65,34 +185,122 @@ class SearchServer
 
 	template <typename ExecutionPolicy> void RemoveDocument(ExecutionPolicy&& policy, int document_id)
 	{
-		if (document_to_word_freqs_.count(document_id) == 1)
+		const auto document_it = documents_.find(document_id);
+		if (document_it == documents_.end())
+		{
+			return;
+		}
+		const DocumentData document_data = document_it->second;
+		documents_.erase(document_it);
+		document_ids_.erase(document_id);
+		total_word_count_ -= document_data.word_count;
+		posting_count_ -= document_data.term_count;
+
+		const auto term_ids_it = document_term_ids_.find(document_id);
+		if (term_ids_it == document_term_ids_.end())
 		{
-			auto find_id = find(policy, document_ids_.begin(), document_ids_.end(), document_id);
-			document_ids_.erase(find_id);
-			documents_.erase(document_id);
-			std::for_each(policy, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-						  [document_id](auto& doc) { doc.second.erase(document_id); });
-			document_to_word_freqs_.erase(document_id);
+			MarkRemoved(document_id, document_data.term_count);
+			return;
 		}
+		// прямой индекс знает термы документа: правим только их списки, а не весь словарь
+		std::for_each(policy, term_ids_it->second.begin(), term_ids_it->second.end(), [this, document_id](int term_id) {
+			word_to_document_freqs_.find(terms_[term_id])->second.erase(document_id);
+		});
+		document_term_ids_.erase(term_ids_it);
+		document_to_word_freqs_.erase(document_id);
+		document_positions_.erase(document_id);
 	}
 
+	// Вычищает из постингов документы, удалённые без прямого индекса (ForwardIndexMode::NONE)
+	void Compact();
+
 	std::set<std::string_view> GetAllWordsInDocument(const int document_id) const;
 
-	std::set<int>::const_iterator begin() const;
+	// Термы индекса, начинающиеся с prefix, по возрастанию, не больше limit штук (автодополнение)
+	std::vector<std::string_view> FindTermsByPrefix(std::string_view prefix,
+													size_t limit = MAX_PREFIX_EXPANSION) const;
+
+	// Дёшево: можно опрашивать раз в несколько секунд. Как и прочие константные методы,
+	// не должен выполняться одновременно с изменением индекса
+	IndexStats GetIndexStats() const;
 
-	std::set<int>::const_iterator end() const;
+	CountedSet<int>::const_iterator begin() const;
+
+	CountedSet<int>::const_iterator end() const;
 
   private:
 	struct DocumentData
 	{
 		int rating;
 		DocumentStatus status;
+		// Длина документа без стоп-слов, нужна для нормировки BM25
+		int word_count;
+		// Число разных термов документа - его постингов в обратном индексе
+		int term_count;
 	};
-	const std::set<std::string> stop_words_;
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-	std::map<int, DocumentData> documents_;
-	std::set<int> document_ids_;
+	const std::set<std::string, std::less<>> stop_words_;
+	const SearchServerOptions options_;
+
+	// Счётчики памяти по структурам. Лежат в куче и делятся при переносе сервера:
+	// на них указывают аллокаторы контейнеров и нового, и перенесённого объекта
+	struct MemoryCounters
+	{
+		MemoryCounter dictionary;
+		MemoryCounter postings;
+		MemoryCounter forward_index;
+		MemoryCounter documents;
+		MemoryCounter positions;
+	};
+	SharedCounters<MemoryCounters> memory_;
+
+	using PostingList = CountedMap<int, double>;
+	using DocumentWords = CountedMap<std::string_view, double>;
+
+	// Словарь термов: строки принадлежат серверу, id термина - индекс в terms_.
+	// Все string_view в индексах ниже указывают сюда, а не в текст документа.
+	std::deque<CountedString, CountingAllocator<CountedString>> terms_{
+		CountingAllocator<CountedString>(&memory_->dictionary)};
+	CountedMap<std::string_view, int> term_ids_{
+		CountedMap<std::string_view, int>::allocator_type(&memory_->dictionary)};
+	// Сжатая копия словаря для префиксных запросов, собирается при первом запросе после новых термов
+	LazyTermDictionary term_dictionary_;
+	CountedMap<std::string_view, PostingList> word_to_document_freqs_{
+		CountedMap<std::string_view, PostingList>::allocator_type(&memory_->postings)};
+	CountedMap<int, DocumentWords> document_to_word_freqs_{
+		CountedMap<int, DocumentWords>::allocator_type(&memory_->forward_index)};
+	CountedMap<int, DocumentData> documents_{CountedMap<int, DocumentData>::allocator_type(&memory_->documents)};
+	CountedSet<int> document_ids_{CountedSet<int>::allocator_type(&memory_->documents)};
+	// Отсортированные id термов документа, по ним MatchDocument пересекается с запросом
+	CountedMap<int, CountedVector<int>> document_term_ids_{
+		CountedMap<int, CountedVector<int>>::allocator_type(&memory_->forward_index)};
+
+	// Позиции термов документа: для i-го терма из document_term_ids_ - байты
+	// [offsets[i], offsets[i + 1]) в data, возрастающие позиции дельтами в varint
+	struct DocumentPositions
+	{
+		explicit DocumentPositions(MemoryCounter& counter)
+			: offsets(CountingAllocator<uint32_t>(&counter)), data(CountingAllocator<uint8_t>(&counter))
+		{
+		}
+
+		CountedVector<uint32_t> offsets;
+		CountedVector<uint8_t> data;
+	};
+	CountedMap<int, DocumentPositions> document_positions_{
+		CountedMap<int, DocumentPositions>::allocator_type(&memory_->positions)};
+	int64_t total_word_count_ = 0;
+	int64_t posting_count_ = 0;
+	// Документы, удалённые без прямого индекса: их постинги ещё в word_to_document_freqs_.
+	// Отсортированные id, а не битовая карта: память по числу удалённых, а не по самому большому id
+	CountedVector<int> removed_documents_{CountingAllocator<int>(&memory_->documents)};
+	int64_t removed_posting_count_ = 0;
+
+	bool IsRemoved(int document_id) const;
+
+	void MarkRemoved(int document_id, int term_count);
+
+	// callback(терм, частота) для каждого терма документа; порядок зависит от режима прямого индекса
+	template <typename Callback> void ForEachDocumentTerm(int document_id, Callback callback) const;
 
 	bool IsStopWord(const std::string_view word) const;
 
@@ -111,23 +319,108 @@ class SearchServer
 
 	QueryWord ParseQueryWord(std::string_view text) const;
 
+	// Фраза из запроса: слова и их смещения от начала фразы (стоп-слова дают пропуск),
+	// slop - сколько лишних позиций допускается между словами ("a b"~N)
+	struct Phrase
+	{
+		std::vector<std::string> words;
+		std::vector<int> offsets;
+		int slop = 0;
+	};
+
 	struct Query
 	{
 		std::set<std::string, std::less<>> plus_words;
 		std::set<std::string, std::less<>> minus_words;
+		std::vector<Phrase> phrases;
 	};
 
 	Query ParseQuery(std::string_view text) const;
 
+	// Запрос в виде отсортированных id термов; слова не из словаря отброшены,
+	// так как ни с одним документом совпасть не могут
+	struct QueryTermIds
+	{
+		std::vector<int> plus_ids;
+		std::vector<int> minus_ids;
+	};
+
+	QueryTermIds ParseQueryTermIds(std::string_view text) const;
+
+	QueryTermIds ToTermIds(const Query& query) const;
+
+	std::vector<int> GetTermPositions(int document_id, int term_id) const;
+
+	bool MatchesPhrase(int document_id, const Phrase& phrase) const;
+
+	bool MatchesPhrases(int document_id, const std::vector<Phrase>& phrases) const;
+
+	int GetOrAddTermId(std::string_view word);
+
+	template <typename Callback> void ForEachTermWithPrefix(std::string_view prefix, size_t limit, Callback callback) const
+	{
+		const auto dictionary = term_dictionary_.Get(terms_.size(), [this] {
+			return std::vector<std::pair<std::string_view, int>>(term_ids_.begin(), term_ids_.end());
+		});
+		dictionary->ForEachWithPrefix(prefix, limit, [this, &callback](std::string_view, int term_id) {
+			callback(std::string_view(terms_[term_id]));
+		});
+	}
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocumentTermIds(std::string_view raw_query,
+																				   int document_id) const;
+
 	// Existence required
 	double ComputeWordInverseDocumentFreq(const std::string_view word) const;
 
+	// Скореры подставляются в FindAllDocuments шаблонным параметром, так что на каждый
+	// постинг нет ни виртуального вызова, ни ветвления по типу ранжирования.
+	// WordWeight считается один раз на слово запроса, operator() - на каждый постинг.
+	struct TfIdfScorer
+	{
+		const SearchServer& server;
+
+		double WordWeight(std::string_view word) const
+		{
+			return server.ComputeWordInverseDocumentFreq(word);
+		}
+
+		double operator()(double word_weight, double term_freq, const DocumentData&) const
+		{
+			return term_freq * word_weight;
+		}
+	};
+
+	struct Bm25Scorer
+	{
+		explicit Bm25Scorer(const SearchServer& search_server);
+
+		double WordWeight(std::string_view word) const;
+
+		double operator()(double word_weight, double term_freq, const DocumentData& document_data) const
+		{
+			// term_freq хранится нормированным на длину документа, возвращаем абсолютное число вхождений
+			const double count = term_freq * document_data.word_count;
+			return word_weight * count / (count + norm_base + norm_slope * document_data.word_count);
+		}
+
+		const SearchServer& server;
+		double norm_base;
+		double norm_slope;
+	};
+
+	static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
 	template <typename DocumentPredicate>
 	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
 
 	template <typename ExecutionPolicy, typename DocumentPredicate>
 	std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query,
 										   DocumentPredicate document_predicate) const;
+
+	template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+	std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query,
+										   DocumentPredicate document_predicate, const Scorer& scorer) const;
 };
 
 template <typename DocumentPredicate>
@@ -146,24 +439,37 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Documen
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const SearchServer::Query& query,
 													 DocumentPredicate document_predicate) const
+{
+	return FindAllDocuments(policy, query, document_predicate, TfIdfScorer{*this});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const SearchServer::Query& query,
+													 DocumentPredicate document_predicate, const Scorer& scorer) const
 {
 	constexpr bool is_par = std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>;
 	if (is_par)
 	{
 		ConcurrentMap<int, double> document_to_relevance(97);
 		for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-				 [this, document_predicate, &document_to_relevance](std::string_view word) {
+				 [this, document_predicate, &scorer, &document_to_relevance](std::string_view word) {
 					 if (word_to_document_freqs_.count(word) == 0)
 					 {
 						 return;
 					 }
-					 const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+					 const double word_weight = scorer.WordWeight(word);
 					 for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
 					 {
-						 const auto& document_data = documents_.at(document_id);
+						 const auto document_it = documents_.find(document_id);
+						 if (document_it == documents_.end())
+						 {
+							 continue; // удалён, постинг ждёт Compact
+						 }
+						 const auto& document_data = document_it->second;
 						 if (document_predicate(document_id, document_data.status, document_data.rating))
 						 {
-							 document_to_relevance[document_id].ref_to_value_ += term_freq * inverse_document_freq;
+							 document_to_relevance[document_id].ref_to_value_ +=
+								 scorer(word_weight, term_freq, document_data);
 						 }
 					 }
 				 });
@@ -183,6 +489,10 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, con
 		std::vector<Document> matched_documents;
 		for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
 		{
+			if (!MatchesPhrases(document_id, query.phrases))
+			{
+				continue;
+			}
 			matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
 		}
 		return matched_documents;
@@ -196,13 +506,18 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, con
 			{
 				continue;
 			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+			const double word_weight = scorer.WordWeight(word);
 			for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
 			{
-				const auto& document_data = documents_.at(document_id);
+				const auto document_it = documents_.find(document_id);
+				if (document_it == documents_.end())
+				{
+					continue; // удалён, постинг ждёт Compact
+				}
+				const auto& document_data = document_it->second;
 				if (document_predicate(document_id, document_data.status, document_data.rating))
 				{
-					document_to_relevance[document_id] += term_freq * inverse_document_freq;
+					document_to_relevance[document_id] += scorer(word_weight, term_freq, document_data);
 				}
 			}
 		}
@@ -222,93 +537,48 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, con
 		std::vector<Document> matched_documents;
 		for (const auto [document_id, relevance] : document_to_relevance)
 		{
+			if (!MatchesPhrases(document_id, query.phrases))
+			{
+				continue;
+			}
 			matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
 		}
 		return matched_documents;
 	}
 }
 
+// Запрос короткий, документ - отсортированный вектор id термов: пересечение галопом
+// дешевле любого распараллеливания, поэтому seq и par идут одним путём
 template <typename ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy&& policy,
 																					  std::string_view raw_query,
 																					  int document_id) const
 {
-	constexpr bool is_par = std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>;
-	const auto query = ParseQuery(raw_query);
-	const auto status = documents_.at(document_id).status;
-	if (is_par)
-	{
-
-		const auto word_checker = [this, document_id](std::string_view word) {
-			const auto it = word_to_document_freqs_.find(std::string(word));
-			return it != word_to_document_freqs_.end() && it->second.count(document_id);
-		};
-
-		if (any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker))
-		{
-			return {{}, status};
-		}
-
-		std::vector<std::string_view> matched_words(query.plus_words.size());
-		auto words_end = copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-								 matched_words.begin(), word_checker);
-		std::sort(matched_words.begin(), words_end);
-		words_end = std::unique(matched_words.begin(), words_end);
-		matched_words.erase(words_end, matched_words.end());
-
-		return {matched_words, status};
-	}
-	else
-	{
-
-		for (const std::string_view word : query.minus_words)
-		{
-			if (word_to_document_freqs_.count(std::string(word)) == 0)
-			{
-				continue;
-			}
-			if (word_to_document_freqs_.at(std::string(word)).count(document_id))
-			{
-				return {{}, status};
-			}
-		}
-
-		std::vector<std::string_view> matched_words;
-		for (const std::string_view word : query.plus_words)
-		{
-			if (word_to_document_freqs_.count(std::string(word)) == 0)
-			{
-				continue;
-			}
-			if (word_to_document_freqs_.at(std::string(word)).count(document_id))
-			{
-				matched_words.push_back(word);
-			}
-		}
-		return {matched_words, status};
-	}
+	return MatchDocumentTermIds(raw_query, document_id);
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy execution_policy, const std::string_view raw_query,
 													 DocumentPredicate document_predicate) const
 {
+	return FindTopDocuments(execution_policy, raw_query, document_predicate, RankingFunction::TF_IDF);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy execution_policy, const std::string_view raw_query,
+													 DocumentPredicate document_predicate,
+													 RankingFunction ranking) const
+{
 
 	const auto query = ParseQuery(std::string(raw_query));
 
-	auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-
-	sort(execution_policy, matched_documents.begin(), matched_documents.end(),
-		 [](const Document& lhs, const Document& rhs) {
-			 if (std::abs(lhs.relevance - rhs.relevance) < 1e-6)
-			 {
-				 return lhs.rating > rhs.rating;
-			 }
-			 else
-			 {
-				 return lhs.relevance > rhs.relevance;
-			 }
-		 });
+	// ветвление по функции ранжирования - один раз на запрос
+	auto matched_documents =
+		ranking == RankingFunction::BM25
+			? FindAllDocuments(std::execution::par, query, document_predicate, Bm25Scorer(*this))
+			: FindAllDocuments(std::execution::par, query, document_predicate, TfIdfScorer{*this});
+
+	sort(execution_policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
 	if (int(matched_documents.size()) > MAX_RESULT_DOCUMENT_COUNT)
 	{
 		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
@@ -334,3 +604,32 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy execution_p
 		return FindTopDocuments(raw_query);
 	}
 }
+
+template <typename Callback> void SearchServer::ForEachDocumentTerm(int document_id, Callback callback) const
+{
+	if (const auto it = document_to_word_freqs_.find(document_id); it != document_to_word_freqs_.end())
+	{
+		for (const auto& [term, term_freq] : it->second)
+		{
+			callback(term, term_freq);
+		}
+	}
+	else if (const auto it = document_term_ids_.find(document_id); it != document_term_ids_.end())
+	{
+		for (const int term_id : it->second)
+		{
+			const std::string_view term = terms_[term_id];
+			callback(term, word_to_document_freqs_.find(term)->second.at(document_id));
+		}
+	}
+	else if (documents_.count(document_id) > 0)
+	{
+		for (const auto& [term, postings] : word_to_document_freqs_)
+		{
+			if (const auto posting = postings.find(document_id); posting != postings.end())
+			{
+				callback(term, posting->second);
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+
+// Первый элемент [first, last), не меньше value. Шаг удваивается, пока не перешагнём value,
+// затем бинарный поиск в последнем интервале: O(log d), где d - расстояние до ответа.
+template <typename RandomIt, typename T> RandomIt GallopLowerBound(RandomIt first, RandomIt last, const T& value)
+{
+	if (first == last || !(*first < value))
+	{
+		return first;
+	}
+	const auto size = last - first;
+	typename std::iterator_traits<RandomIt>::difference_type bound = 1;
+	while (bound < size && first[bound] < value)
+	{
+		bound *= 2;
+	}
+	return std::lower_bound(first + bound / 2 + 1, first + std::min(bound + 1, size), value);
+}
+
+// Пересечение двух отсортированных диапазонов без повторов: короткий проходим линейно,
+// по длинному прыгаем галопом. Для каждого общего элемента вызывается on_match.
+template <typename SmallIt, typename LargeIt, typename Callback>
+void GallopingIntersect(SmallIt small_first, SmallIt small_last, LargeIt large_first, LargeIt large_last,
+						Callback on_match)
+{
+	for (; small_first != small_last && large_first != large_last; ++small_first)
+	{
+		large_first = GallopLowerBound(large_first, large_last, *small_first);
+		if (large_first != large_last && !(*small_first < *large_first))
+		{
+			on_match(*small_first);
+			++large_first;
+		}
+	}
+}
@@ -1,13 +1,15 @@
 #pragma once
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
-template <typename StringContainer> std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings)
+template <typename StringContainer>
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings)
 {
-	std::set<std::string> non_empty_strings;
+	std::set<std::string, std::less<>> non_empty_strings;
 	for (const auto& str : strings)
 	{
 		if (str.size() > 0)
@@ -0,0 +1,71 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+TermDictionary::TermDictionary(const std::vector<std::pair<std::string_view, int>>& sorted_terms)
+	: size_(sorted_terms.size())
+{
+	block_offsets_.reserve((sorted_terms.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	std::string_view previous;
+	for (size_t i = 0; i < sorted_terms.size(); ++i)
+	{
+		const auto& [term, term_id] = sorted_terms[i];
+		size_t shared = 0;
+		if (i % BLOCK_SIZE == 0)
+		{
+			block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+		}
+		else
+		{
+			const size_t max_shared = std::min(previous.size(), term.size());
+			while (shared < max_shared && previous[shared] == term[shared])
+			{
+				++shared;
+			}
+		}
+		WriteVarint(data_, static_cast<uint32_t>(shared));
+		WriteVarint(data_, static_cast<uint32_t>(term.size() - shared));
+		data_.insert(data_.end(), term.begin() + shared, term.end());
+		WriteVarint(data_, static_cast<uint32_t>(term_id));
+		previous = term;
+	}
+	data_.shrink_to_fit();
+}
+
+size_t TermDictionary::size() const
+{
+	return size_;
+}
+
+size_t TermDictionary::ByteSize() const
+{
+	return data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t);
+}
+
+// Последний блок, первый терм которого меньше prefix: префиксный диапазон начинается в нём
+size_t TermDictionary::FindFirstBlock(std::string_view prefix) const
+{
+	size_t low = 0;
+	size_t high = block_offsets_.size();
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (BlockFirstTerm(middle) < prefix)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low == 0 ? 0 : low - 1;
+}
+
+std::string_view TermDictionary::BlockFirstTerm(size_t block) const
+{
+	const uint8_t* pos = data_.data() + block_offsets_[block];
+	ReadVarint(pos); // у первого терма блока общий префикс всегда пуст
+	const uint32_t size = ReadVarint(pos);
+	return {reinterpret_cast<const char*>(pos), size};
+}
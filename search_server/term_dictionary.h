@@ -0,0 +1,124 @@
+#pragma once
+
+#include "varint.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Неизменяемый отсортированный словарь термов с front-coding: термы идут блоками по BLOCK_SIZE,
+// первый терм блока хранится целиком, остальные - длиной общего с предыдущим префикса и суффиксом.
+// Поиск по префиксу - бинарный поиск по первым термам блоков и линейный проход по совпадениям.
+class TermDictionary
+{
+  public:
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	TermDictionary() = default;
+
+	// Термы должны быть отсортированы по возрастанию и не повторяться
+	explicit TermDictionary(const std::vector<std::pair<std::string_view, int>>& sorted_terms);
+
+	// Вызывает callback(term, term_id) для термов с префиксом prefix в порядке возрастания,
+	// но не больше limit раз. Возвращает число вызовов
+	template <typename Callback> size_t ForEachWithPrefix(std::string_view prefix, size_t limit, Callback callback) const;
+
+	size_t size() const;
+
+	size_t ByteSize() const;
+
+  private:
+	size_t FindFirstBlock(std::string_view prefix) const;
+
+	std::string_view BlockFirstTerm(size_t block) const;
+
+	std::vector<uint8_t> data_;
+	std::vector<uint32_t> block_offsets_;
+	size_t size_ = 0;
+};
+
+// Потокобезопасная ленивая обёртка: словарь пересобирается, когда в нём меньше термов,
+// чем у владельца. Копирование запрещено, перенос забирает уже собранный словарь.
+class LazyTermDictionary
+{
+  public:
+	LazyTermDictionary() = default;
+
+	LazyTermDictionary(const LazyTermDictionary&) = delete;
+	LazyTermDictionary& operator=(const LazyTermDictionary&) = delete;
+
+	LazyTermDictionary(LazyTermDictionary&& other) noexcept : dictionary_(std::move(other.dictionary_))
+	{
+	}
+
+	LazyTermDictionary& operator=(LazyTermDictionary&& other) noexcept
+	{
+		std::scoped_lock lock(mutex_, other.mutex_);
+		dictionary_ = std::move(other.dictionary_);
+		return *this;
+	}
+
+	// build() возвращает отсортированные пары (терм, id) и вызывается только при пересборке
+	template <typename Builder> std::shared_ptr<const TermDictionary> Get(size_t term_count, Builder build) const
+	{
+		std::lock_guard guard(mutex_);
+		if (!dictionary_ || dictionary_->size() != term_count)
+		{
+			dictionary_ = std::make_shared<const TermDictionary>(build());
+		}
+		return dictionary_;
+	}
+
+	// Размер уже собранного словаря, без пересборки
+	size_t ByteSize() const
+	{
+		std::lock_guard guard(mutex_);
+		return dictionary_ ? dictionary_->ByteSize() : 0;
+	}
+
+  private:
+	mutable std::mutex mutex_;
+	mutable std::shared_ptr<const TermDictionary> dictionary_;
+};
+
+template <typename Callback>
+size_t TermDictionary::ForEachWithPrefix(std::string_view prefix, size_t limit, Callback callback) const
+{
+	size_t found = 0;
+	std::string term;
+	for (size_t block = FindFirstBlock(prefix); block < block_offsets_.size() && found < limit; ++block)
+	{
+		const uint8_t* pos = data_.data() + block_offsets_[block];
+		const uint8_t* block_end =
+			block + 1 < block_offsets_.size() ? data_.data() + block_offsets_[block + 1] : data_.data() + data_.size();
+		while (pos != block_end)
+		{
+			const uint32_t shared = ReadVarint(pos);
+			const uint32_t suffix_size = ReadVarint(pos);
+			term.resize(shared);
+			term.append(reinterpret_cast<const char*>(pos), suffix_size);
+			pos += suffix_size;
+			const int term_id = static_cast<int>(ReadVarint(pos));
+
+			const std::string_view view = term;
+			if (view.substr(0, prefix.size()) == prefix)
+			{
+				callback(view, term_id);
+				if (++found == limit)
+				{
+					return found;
+				}
+			}
+			else if (view > prefix)
+			{
+				// термы отсортированы: после префиксного диапазона совпадений уже не будет
+				return found;
+			}
+		}
+	}
+	return found;
+}
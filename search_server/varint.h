@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// LEB128: 7 бит на байт, старший бит - признак продолжения. out - вектор байт с любым аллокатором
+template <typename ByteVector> inline void WriteVarint(ByteVector& out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint32_t ReadVarint(const uint8_t*& pos)
+{
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7)
+	{
+		const uint8_t byte = *pos++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return value;
+		}
+	}
+}
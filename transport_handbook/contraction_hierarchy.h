@@ -0,0 +1,530 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Contraction Hierarchies: вершины по очереди «стягиваются», а кратчайшие пути через стянутую
+    // вершину заменяются шорткатами. Запрос - двунаправленный Дейкстра только вверх по рангам,
+    // он просматривает малую часть графа. Шорткат хранит два ребра, из которых собран, и его вес -
+    // их сумма (operator+ у Weight), так что ответ раскрывается в исходные рёбра графа.
+    // Данные иерархии (ранги и рёбра) можно сохранить и восстановить без пересчёта.
+    template<typename Weight>
+    class ContractionHierarchy : public RouteEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // Исходное ребро графа (second == NO_EDGE, first - id ребра в графе)
+        // или шорткат из рёбер иерархии first и second, добавленных раньше него
+        struct HierarchyEdge {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        struct Data {
+            std::vector<size_t> ranks;
+            std::vector<HierarchyEdge> edges;
+        };
+
+        // Предварительный расчёт иерархии
+        explicit ContractionHierarchy(const Graph &graph);
+
+        // Готовая иерархия для того же графа; несогласованные данные - std::invalid_argument
+        ContractionHierarchy(const Graph &graph, Data data);
+
+        using RouteInfo = typename RouteEngine<Weight>::RouteInfo;
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        const Data &GetData() const {
+            return data_;
+        }
+
+    private:
+        // Сколько вершин максимум просматривает поиск свидетеля. Не найденный из-за лимита
+        // свидетель даёт лишний шорткат, но не ломает корректность
+        static constexpr size_t WITNESS_SETTLE_LIMIT = 256;
+        // Для оценки приоритета хватает грубого поиска: лишний шорткат тут лишь чуть сдвигает порядок
+        static constexpr size_t PRIORITY_SETTLE_LIMIT = 16;
+
+        struct Arc {
+            VertexId vertex;
+            EdgeId edge;
+        };
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+        };
+
+        static bool IsFartherThan(const QueueItem &lhs, const QueueItem &rhs) {
+            return lhs.weight > rhs.weight;
+        }
+
+        // Состояние одного направления поиска; метки эпох как в DijkstraRouter
+        struct SearchSide {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<uint32_t> reached;
+            std::vector<uint32_t> settled;
+            std::vector<QueueItem> queue;
+
+            void Resize(size_t vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                reached.resize(vertex_count, 0);
+                settled.resize(vertex_count, 0);
+            }
+
+            void Reset() {
+                std::fill(reached.begin(), reached.end(), 0);
+                std::fill(settled.begin(), settled.end(), 0);
+            }
+
+            bool Reach(VertexId vertex, Weight weight, EdgeId prev_edge, uint32_t epoch) {
+                if (settled[vertex] == epoch || (reached[vertex] == epoch && !(weight < weights[vertex]))) {
+                    return false;
+                }
+                reached[vertex] = epoch;
+                weights[vertex] = weight;
+                prev_edges[vertex] = prev_edge;
+                queue.push_back({weight, vertex});
+                std::push_heap(queue.begin(), queue.end(), IsFartherThan);
+                return true;
+            }
+
+            // Достаёт ближайшую ещё не окончательную вершину
+            std::optional<VertexId> SettleNext(uint32_t epoch) {
+                while (!queue.empty()) {
+                    std::pop_heap(queue.begin(), queue.end(), IsFartherThan);
+                    const VertexId vertex = queue.back().vertex;
+                    queue.pop_back();
+                    if (settled[vertex] != epoch) {
+                        settled[vertex] = epoch;
+                        return vertex;
+                    }
+                }
+                return std::nullopt;
+            }
+        };
+
+        struct Scratch {
+            SearchSide forward;
+            SearchSide backward;
+            uint32_t epoch = 0;
+        };
+
+        static Scratch &PrepareScratch(size_t vertex_count);
+
+        // Контракция: рабочие списки смежности, порядок вершин и шорткаты
+        class Contractor;
+
+        void Validate() const;
+
+        void BuildSearchGraph();
+
+        void Unpack(EdgeId hierarchy_edge, std::vector<EdgeId> &edges) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph &graph_;
+        Data data_;
+        // Рёбра к вершинам выше рангом, сгруппированные по началу (CSR)
+        std::vector<size_t> upward_offsets_;
+        std::vector<Arc> upward_arcs_;
+        // Рёбра из вершин выше рангом, сгруппированные по концу: обратный поиск идёт по ним вверх
+        std::vector<size_t> downward_offsets_;
+        std::vector<Arc> downward_arcs_;
+    };
+
+    template<typename Weight>
+    class ContractionHierarchy<Weight>::Contractor {
+    public:
+        Contractor(const Graph &graph, Data &data) : graph_(graph), data_(data) {
+            const size_t vertex_count = graph.GetVertexCount();
+            out_.resize(vertex_count);
+            in_.resize(vertex_count);
+            contracted_.assign(vertex_count, false);
+            contracted_neighbours_.assign(vertex_count, 0);
+            witness_.Resize(vertex_count);
+            target_marks_.assign(vertex_count, 0);
+            AddOriginalEdges();
+        }
+
+        void Run() {
+            const size_t vertex_count = graph_.GetVertexCount();
+            using Priority = std::pair<int, VertexId>;
+            std::priority_queue<Priority, std::vector<Priority>, std::greater<>> queue;
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                queue.push({ComputePriority(vertex), vertex});
+            }
+            data_.ranks.assign(vertex_count, 0);
+            size_t rank = 0;
+            while (!queue.empty()) {
+                const VertexId vertex = queue.top().second;
+                queue.pop();
+                // ленивое обновление: приоритет мог вырасти после стягивания соседей
+                const int priority = ComputePriority(vertex);
+                if (!queue.empty() && priority > queue.top().first) {
+                    queue.push({priority, vertex});
+                    continue;
+                }
+                Contract(vertex, true);
+                contracted_[vertex] = true;
+                data_.ranks[vertex] = rank++;
+                Detach(vertex);
+            }
+        }
+
+    private:
+        void AddOriginalEdges() {
+            // из параллельных рёбер в кратчайший путь может попасть только самое лёгкое
+            const size_t vertex_count = graph_.GetVertexCount();
+            std::vector<EdgeId> best(vertex_count, NO_EDGE);
+            std::vector<VertexId> targets;
+            for (VertexId from = 0; from < vertex_count; ++from) {
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(from)) {
+                    const auto &edge = graph_.GetEdge(edge_id);
+                    if (edge.to == from) {
+                        continue;
+                    }
+                    if (best[edge.to] == NO_EDGE) {
+                        targets.push_back(edge.to);
+                        best[edge.to] = edge_id;
+                    } else if (edge.weight < graph_.GetEdge(best[edge.to]).weight) {
+                        best[edge.to] = edge_id;
+                    }
+                }
+                for (const VertexId to : targets) {
+                    const auto &edge = graph_.GetEdge(best[to]);
+                    AddEdge({from, to, edge.weight, best[to], NO_EDGE});
+                    best[to] = NO_EDGE;
+                }
+                targets.clear();
+            }
+        }
+
+        void AddEdge(HierarchyEdge edge) {
+            const EdgeId id = data_.edges.size();
+            out_[edge.from].push_back({edge.to, id});
+            in_[edge.to].push_back({edge.from, id});
+            data_.edges.push_back(std::move(edge));
+        }
+
+        // Шорткат заменяет в рабочих списках более тяжёлое ребро между теми же вершинами
+        void AddShortcut(VertexId from, VertexId to, Weight weight, EdgeId first, EdgeId second) {
+            const EdgeId id = data_.edges.size();
+            data_.edges.push_back({from, to, weight, first, second});
+            const auto replace = [id](std::vector<Arc> &arcs, VertexId vertex) {
+                for (Arc &arc : arcs) {
+                    if (arc.vertex == vertex) {
+                        arc.edge = id;
+                        return true;
+                    }
+                }
+                arcs.push_back({vertex, id});
+                return false;
+            };
+            replace(out_[from], to);
+            replace(in_[to], from);
+        }
+
+        // Убирает стянутую вершину из рабочих списков соседей: дальше поиски её не видят
+        void Detach(VertexId vertex) {
+            const auto is_vertex = [vertex](const Arc &arc) { return arc.vertex == vertex; };
+            for (const Arc &arc : out_[vertex]) {
+                ++contracted_neighbours_[arc.vertex];
+                auto &arcs = in_[arc.vertex];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(), is_vertex), arcs.end());
+            }
+            for (const Arc &arc : in_[vertex]) {
+                ++contracted_neighbours_[arc.vertex];
+                auto &arcs = out_[arc.vertex];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(), is_vertex), arcs.end());
+            }
+            out_[vertex] = {};
+            in_[vertex] = {};
+        }
+
+        int ComputePriority(VertexId vertex) {
+            const int shortcuts = Contract(vertex, false);
+            const int degree = static_cast<int>(out_[vertex].size() + in_[vertex].size());
+            return shortcuts - degree + contracted_neighbours_[vertex];
+        }
+
+        // Считает (и при add добавляет) шорткаты, нужные при стягивании vertex
+        int Contract(VertexId vertex, bool add) {
+            int shortcuts = 0;
+            // копия: AddShortcut может дописать в списки соседей
+            const std::vector<Arc> targets = out_[vertex];
+            if (targets.empty()) {
+                return 0;
+            }
+            ++target_epoch_;
+            for (const Arc &target : targets) {
+                target_marks_[target.vertex] = target_epoch_;
+            }
+            const std::vector<Arc> sources = in_[vertex];
+            for (const Arc &in : sources) {
+                const Weight in_weight = data_.edges[in.edge].weight; // копия: AddShortcut растит data_.edges
+                std::optional<Weight> limit;
+                for (const auto &[to, out_edge] : targets) {
+                    const Weight candidate = in_weight + data_.edges[out_edge].weight;
+                    if (to != in.vertex && (!limit || *limit < candidate)) {
+                        limit = candidate;
+                    }
+                }
+                if (!limit) {
+                    continue;
+                }
+                FindWitnesses(in.vertex, vertex, *limit, targets.size(),
+                              add ? WITNESS_SETTLE_LIMIT : PRIORITY_SETTLE_LIMIT);
+                for (const auto &[to, out_edge] : targets) {
+                    if (to == in.vertex) {
+                        continue;
+                    }
+                    const Weight candidate = in_weight + data_.edges[out_edge].weight;
+                    if (witness_.reached[to] == epoch_ && !(candidate < witness_.weights[to])) {
+                        continue; // есть путь не длиннее в обход vertex
+                    }
+                    ++shortcuts;
+                    if (add) {
+                        AddShortcut(in.vertex, to, candidate, in.edge, out_edge);
+                    }
+                }
+            }
+            return shortcuts;
+        }
+
+        // Дейкстра из source по ещё не стянутым вершинам, кроме excluded, до веса limit
+        // или пока не станут окончательными все target_count отмеченных целей
+        void FindWitnesses(VertexId source, VertexId excluded, const Weight &limit, size_t target_count,
+                           size_t settle_limit) {
+            if (++epoch_ == 0) {
+                witness_.Reset();
+                epoch_ = 1;
+            }
+            witness_.queue.clear();
+            witness_.Reach(source, ZERO_WEIGHT, NO_EDGE, epoch_);
+            for (size_t settled = 0; settled < settle_limit; ++settled) {
+                const auto vertex = witness_.SettleNext(epoch_);
+                if (!vertex || limit < witness_.weights[*vertex]) {
+                    return;
+                }
+                if (target_marks_[*vertex] == target_epoch_ && --target_count == 0) {
+                    return;
+                }
+                for (const Arc &arc : out_[*vertex]) {
+                    if (arc.vertex != excluded) {
+                        witness_.Reach(arc.vertex, witness_.weights[*vertex] + data_.edges[arc.edge].weight,
+                                       arc.edge, epoch_);
+                    }
+                }
+            }
+        }
+
+        const Graph &graph_;
+        Data &data_;
+        std::vector<std::vector<Arc>> out_;
+        std::vector<std::vector<Arc>> in_;
+        std::vector<bool> contracted_;
+        std::vector<int> contracted_neighbours_;
+        SearchSide witness_;
+        uint32_t epoch_ = 0;
+        // цели текущего стягивания: соседи по исходящим рёбрам
+        std::vector<uint32_t> target_marks_;
+        uint32_t target_epoch_ = 0;
+    };
+
+    template<typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph &graph) : graph_(graph) {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        Contractor(graph, data_).Run();
+        BuildSearchGraph();
+    }
+
+    template<typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph &graph, Data data)
+            : graph_(graph), data_(std::move(data)) {
+        Validate();
+        BuildSearchGraph();
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::Validate() const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (data_.ranks.size() != vertex_count) {
+            throw std::invalid_argument("Hierarchy does not match the graph: vertex count");
+        }
+        for (EdgeId id = 0; id < data_.edges.size(); ++id) {
+            const HierarchyEdge &edge = data_.edges[id];
+            if (edge.from >= vertex_count || edge.to >= vertex_count) {
+                throw std::invalid_argument("Hierarchy does not match the graph: vertex id");
+            }
+            if (edge.second == NO_EDGE) {
+                if (edge.first >= graph_.GetEdgeCount() || graph_.GetEdge(edge.first).from != edge.from ||
+                    graph_.GetEdge(edge.first).to != edge.to) {
+                    throw std::invalid_argument("Hierarchy does not match the graph: edge");
+                }
+            } else if (edge.first >= id || edge.second >= id || data_.edges[edge.first].from != edge.from ||
+                       data_.edges[edge.first].to != data_.edges[edge.second].from ||
+                       data_.edges[edge.second].to != edge.to) {
+                throw std::invalid_argument("Hierarchy shortcut is inconsistent");
+            }
+        }
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraph() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        upward_offsets_.assign(vertex_count + 1, 0);
+        downward_offsets_.assign(vertex_count + 1, 0);
+        for (const HierarchyEdge &edge : data_.edges) {
+            if (data_.ranks[edge.from] < data_.ranks[edge.to]) {
+                ++upward_offsets_[edge.from + 1];
+            } else {
+                ++downward_offsets_[edge.to + 1];
+            }
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            upward_offsets_[vertex + 1] += upward_offsets_[vertex];
+            downward_offsets_[vertex + 1] += downward_offsets_[vertex];
+        }
+        upward_arcs_.resize(upward_offsets_.back());
+        downward_arcs_.resize(downward_offsets_.back());
+        std::vector<size_t> upward_fill(upward_offsets_.begin(), upward_offsets_.end() - 1);
+        std::vector<size_t> downward_fill(downward_offsets_.begin(), downward_offsets_.end() - 1);
+        for (EdgeId id = 0; id < data_.edges.size(); ++id) {
+            const HierarchyEdge &edge = data_.edges[id];
+            if (data_.ranks[edge.from] < data_.ranks[edge.to]) {
+                upward_arcs_[upward_fill[edge.from]++] = {edge.to, id};
+            } else {
+                downward_arcs_[downward_fill[edge.to]++] = {edge.from, id};
+            }
+        }
+    }
+
+    template<typename Weight>
+    typename ContractionHierarchy<Weight>::Scratch &ContractionHierarchy<Weight>::PrepareScratch(
+            size_t vertex_count) {
+        static thread_local Scratch scratch;
+        if (scratch.forward.weights.size() < vertex_count) {
+            scratch.forward.Resize(vertex_count);
+            scratch.backward.Resize(vertex_count);
+        }
+        if (++scratch.epoch == 0) {
+            scratch.forward.Reset();
+            scratch.backward.Reset();
+            scratch.epoch = 1;
+        }
+        scratch.forward.queue.clear();
+        scratch.backward.queue.clear();
+        return scratch;
+    }
+
+    template<typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(
+            VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ZERO_WEIGHT, {}};
+        }
+        Scratch &scratch = PrepareScratch(vertex_count);
+        const uint32_t epoch = scratch.epoch;
+        SearchSide &forward = scratch.forward;
+        SearchSide &backward = scratch.backward;
+        forward.Reach(from, ZERO_WEIGHT, NO_EDGE, epoch);
+        backward.Reach(to, ZERO_WEIGHT, NO_EDGE, epoch);
+
+        std::optional<Weight> best;
+        VertexId meeting = from;
+        // направление останавливается, когда его ближайшая вершина не легче лучшего пути
+        const auto exhausted = [&best](const SearchSide &side) {
+            return side.queue.empty() || (best && !(side.queue.front().weight < *best));
+        };
+        bool forward_turn = false;
+        while (!exhausted(forward) || !exhausted(backward)) {
+            // направления чередуются, пока оба не исчерпаны
+            forward_turn = exhausted(backward) || (!exhausted(forward) && !forward_turn);
+            SearchSide &side = forward_turn ? forward : backward;
+            const SearchSide &other = forward_turn ? backward : forward;
+            const auto &offsets = forward_turn ? upward_offsets_ : downward_offsets_;
+            const auto &arcs = forward_turn ? upward_arcs_ : downward_arcs_;
+
+            const auto vertex = side.SettleNext(epoch);
+            if (!vertex) {
+                continue;
+            }
+            const Weight weight = side.weights[*vertex];
+            if (other.reached[*vertex] == epoch) {
+                const Weight candidate = weight + other.weights[*vertex];
+                if (!best || candidate < *best) {
+                    best = candidate;
+                    meeting = *vertex;
+                }
+            }
+            for (size_t i = offsets[*vertex]; i < offsets[*vertex + 1]; ++i) {
+                side.Reach(arcs[i].vertex, weight + data_.edges[arcs[i].edge].weight, arcs[i].edge, epoch);
+            }
+        }
+        if (!best) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> path;
+        for (EdgeId edge = forward.prev_edges[meeting]; edge != NO_EDGE;
+             edge = forward.prev_edges[data_.edges[edge].from]) {
+            path.push_back(edge);
+        }
+        std::reverse(path.begin(), path.end());
+        for (EdgeId edge = backward.prev_edges[meeting]; edge != NO_EDGE;
+             edge = backward.prev_edges[data_.edges[edge].to]) {
+            path.push_back(edge);
+        }
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge : path) {
+            Unpack(edge, edges);
+        }
+        return RouteInfo{*best, std::move(edges)};
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::Unpack(EdgeId hierarchy_edge, std::vector<EdgeId> &edges) const {
+        // шорткаты вложены друг в друга; обходим без рекурсии, второе ребро откладываем на стек
+        std::vector<EdgeId> stack{hierarchy_edge};
+        while (!stack.empty()) {
+            const HierarchyEdge &edge = data_.edges[stack.back()];
+            stack.pop_back();
+            if (edge.second == NO_EDGE) {
+                edges.push_back(edge.first);
+            } else {
+                stack.push_back(edge.second);
+                stack.push_back(edge.first);
+            }
+        }
+    }
+
+} // namespace graph
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    // Дейкстра от точки до точки: без предварительного расчёта, память O(V + E).
+    // Рабочие массивы живут в thread_local и переиспользуются между запросами: после первого
+    // запроса в потоке поиск не выделяет память, кроме списка рёбер в ответе.
+    // BuildRoute можно вызывать из нескольких потоков одновременно.
+    template<typename Weight>
+    class DijkstraRouter : public RouteEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        explicit DijkstraRouter(const Graph &graph);
+
+        using RouteInfo = typename RouteEngine<Weight>::RouteInfo;
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+        };
+
+        // Вершина считается посещённой в текущем запросе, если её метка равна epoch:
+        // сброс между запросами - один инкремент вместо очистки массивов
+        struct Scratch {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<uint32_t> reached;
+            std::vector<uint32_t> settled;
+            std::vector<QueueItem> queue;
+            uint32_t epoch = 0;
+        };
+
+        static Scratch &PrepareScratch(size_t vertex_count);
+
+        static bool IsFartherThan(const QueueItem &lhs, const QueueItem &rhs) {
+            return lhs.weight > rhs.weight;
+        }
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph &graph_;
+    };
+
+    template<typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph &graph) : graph_(graph) {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template<typename Weight>
+    typename DijkstraRouter<Weight>::Scratch &DijkstraRouter<Weight>::PrepareScratch(size_t vertex_count) {
+        static thread_local Scratch scratch;
+        if (scratch.weights.size() < vertex_count) {
+            scratch.weights.resize(vertex_count);
+            scratch.prev_edges.resize(vertex_count);
+            scratch.reached.resize(vertex_count, 0);
+            scratch.settled.resize(vertex_count, 0);
+        }
+        if (++scratch.epoch == 0) {
+            // метки прошли полный круг: старые значения могли бы совпасть с новой эпохой
+            std::fill(scratch.reached.begin(), scratch.reached.end(), 0);
+            std::fill(scratch.settled.begin(), scratch.settled.end(), 0);
+            scratch.epoch = 1;
+        }
+        scratch.queue.clear();
+        return scratch;
+    }
+
+    template<typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                               VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex is out of range");
+        }
+        Scratch &scratch = PrepareScratch(vertex_count);
+        const uint32_t epoch = scratch.epoch;
+
+        scratch.weights[from] = ZERO_WEIGHT;
+        scratch.prev_edges[from] = NO_EDGE;
+        scratch.reached[from] = epoch;
+        scratch.queue.push_back({ZERO_WEIGHT, from});
+
+        while (!scratch.queue.empty()) {
+            std::pop_heap(scratch.queue.begin(), scratch.queue.end(), IsFartherThan);
+            const QueueItem item = scratch.queue.back();
+            scratch.queue.pop_back();
+            if (scratch.settled[item.vertex] == epoch) {
+                continue; // устаревшая запись: вершину уже достали с меньшим весом
+            }
+            scratch.settled[item.vertex] = epoch;
+            if (item.vertex == to) {
+                break;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+                const auto &edge = graph_.GetEdge(edge_id);
+                if (scratch.settled[edge.to] == epoch) {
+                    continue;
+                }
+                const Weight candidate = item.weight + edge.weight;
+                if (scratch.reached[edge.to] != epoch || candidate < scratch.weights[edge.to]) {
+                    scratch.reached[edge.to] = epoch;
+                    scratch.weights[edge.to] = candidate;
+                    scratch.prev_edges[edge.to] = edge_id;
+                    scratch.queue.push_back({candidate, edge.to});
+                    std::push_heap(scratch.queue.begin(), scratch.queue.end(), IsFartherThan);
+                }
+            }
+        }
+
+        if (scratch.settled[to] != epoch) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = scratch.prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = scratch.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return RouteInfo{scratch.weights[to], std::move(edges)};
+    }
+
+} // namespace graph
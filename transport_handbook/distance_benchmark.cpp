@@ -0,0 +1,197 @@
+// Бенчмарк таблицы расстояний между остановками на синтетическом городе.
+// Маршруты - случайные блуждания по остановкам, у части перегонов обратное расстояние задано отдельно,
+// seed фиксированный. Поиск идёт вдоль маршрутов туда и обратно, как в GetBusStat.
+// Сравниваются прежний unordered_map по паре указателей с PairPtrHasher, unordered_map по uint64_t
+// с двумя поисками и StopDistanceTable. Результат - JSON Lines в stdout, по строке на структуру:
+// {"stops":..., "pairs":..., "structure":..., "build_ms":..., "lookups":..., "ns_per_lookup":..., "checksum":...}
+#include "stop_distance_table.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	struct BenchmarkSettings
+	{
+		vector<uint32_t> stop_counts = {2'000, 10'000, 40'000};
+		int stops_per_bus = 10;
+		int route_length = 30;
+		double reverse_distance_ratio = 0.3;
+		int lookup_rounds = 20;
+		// PairPtrHasher даёт почти сплошные коллизии: его гоняем один круг и только на небольших городах
+		int legacy_lookup_rounds = 1;
+		uint32_t legacy_max_stops = 10'000;
+		uint32_t seed = 42;
+	};
+
+	struct Stop
+	{
+		uint32_t id;
+	};
+
+	using PairPtrs = pair<const Stop*, const Stop*>;
+
+	// Хеш из справочника до перехода на StopId
+	struct PairPtrHasher
+	{
+		uint64_t operator()(const PairPtrs& stops_ptr) const
+		{
+			size_t ptrValue1 = reinterpret_cast<size_t>(stops_ptr.first);
+			size_t ptrValue2 = reinterpret_cast<size_t>(stops_ptr.second);
+			double res_hash = ptrValue1 + ptrValue2 * 47;
+			return static_cast<uint64_t>(std::sqrt(res_hash));
+		}
+	};
+
+	struct City
+	{
+		deque<Stop> stops;
+		vector<vector<uint32_t>> routes;
+		vector<tuple<uint32_t, uint32_t, int>> distances;
+	};
+
+	City MakeCity(uint32_t stop_count, const BenchmarkSettings& settings)
+	{
+		mt19937 generator(settings.seed);
+		uniform_int_distribution<uint32_t> any_stop(0, stop_count - 1);
+		uniform_int_distribution<uint32_t> step(1, 50);
+		uniform_int_distribution<int> distance(100, 5'000);
+		bernoulli_distribution has_reverse(settings.reverse_distance_ratio);
+
+		City city;
+		for (uint32_t id = 0; id < stop_count; ++id)
+		{
+			city.stops.push_back({id});
+		}
+		const uint32_t bus_count = stop_count / settings.stops_per_bus;
+		for (uint32_t bus = 0; bus < bus_count; ++bus)
+		{
+			// соседние остановки маршрута близки по id: так же их раздаёт справочник при загрузке района
+			auto& route = city.routes.emplace_back();
+			route.push_back(any_stop(generator));
+			for (int i = 1; i < settings.route_length; ++i)
+			{
+				route.push_back((route.back() + step(generator)) % stop_count);
+			}
+			for (size_t i = 1; i < route.size(); ++i)
+			{
+				city.distances.emplace_back(route[i - 1], route[i], distance(generator));
+				if (has_reverse(generator))
+				{
+					city.distances.emplace_back(route[i], route[i - 1], distance(generator));
+				}
+			}
+		}
+		return city;
+	}
+
+	template <typename Build, typename Find>
+	void Measure(const City& city, int lookup_rounds, const char* structure, Build build, Find find)
+	{
+		using Clock = chrono::steady_clock;
+
+		const auto build_start = Clock::now();
+		auto table = build();
+		const auto build_time = Clock::now() - build_start;
+
+		int64_t checksum = 0;
+		int64_t lookups = 0;
+		const auto find_start = Clock::now();
+		for (int round = 0; round < lookup_rounds; ++round)
+		{
+			for (const auto& route : city.routes)
+			{
+				for (size_t i = 1; i < route.size(); ++i)
+				{
+					checksum += find(table, route[i - 1], route[i]);
+					checksum += find(table, route[i], route[i - 1]);
+				}
+				lookups += static_cast<int64_t>(route.size() - 1) * 2;
+			}
+		}
+		const auto find_time = Clock::now() - find_start;
+
+		cout << "{\"stops\":" << city.stops.size() << ",\"pairs\":" << city.distances.size() << ",\"structure\":\""
+			 << structure << "\",\"build_ms\":" << chrono::duration<double, milli>(build_time).count()
+			 << ",\"lookups\":" << lookups << ",\"ns_per_lookup\":"
+			 << chrono::duration<double, nano>(find_time).count() / static_cast<double>(lookups)
+			 << ",\"checksum\":" << checksum << "}" << endl;
+	}
+
+	void RunCity(uint32_t stop_count, const BenchmarkSettings& settings)
+	{
+		const City city = MakeCity(stop_count, settings);
+
+		if (stop_count <= settings.legacy_max_stops)
+		{
+			Measure(
+				city, settings.legacy_lookup_rounds, "pair_ptr_sqrt_hash",
+				[&city] {
+					unordered_map<PairPtrs, int, PairPtrHasher> table;
+					for (const auto& [from, to, distance] : city.distances)
+					{
+						table.insert({{&city.stops[from], &city.stops[to]}, distance});
+					}
+					return table;
+				},
+				[&city](const auto& table, uint32_t from, uint32_t to) {
+					auto it = table.find({&city.stops[from], &city.stops[to]});
+					if (it == table.end())
+					{
+						it = table.find({&city.stops[to], &city.stops[from]});
+					}
+					return it->second;
+				});
+		}
+
+		Measure(
+			city, settings.lookup_rounds, "uint64_key_two_probes",
+			[&city] {
+				unordered_map<uint64_t, int> table;
+				for (const auto& [from, to, distance] : city.distances)
+				{
+					table.insert({static_cast<uint64_t>(from) << 32 | to, distance});
+				}
+				return table;
+			},
+			[](const auto& table, uint32_t from, uint32_t to) {
+				auto it = table.find(static_cast<uint64_t>(from) << 32 | to);
+				if (it == table.end())
+				{
+					it = table.find(static_cast<uint64_t>(to) << 32 | from);
+				}
+				return it->second;
+			});
+
+		Measure(
+			city, settings.lookup_rounds, "stop_distance_table",
+			[&city] {
+				Handbook::Data::StopDistanceTable table;
+				for (const auto& [from, to, distance] : city.distances)
+				{
+					table.Insert(from, to, distance);
+				}
+				return table;
+			},
+			[](const auto& table, uint32_t from, uint32_t to) { return *table.Find(from, to); });
+	}
+} // namespace
+
+int main()
+{
+	const BenchmarkSettings settings;
+	for (const uint32_t stop_count : settings.stop_counts)
+	{
+		RunCity(stop_count, settings);
+	}
+}
@@ -0,0 +1,453 @@
+#include "flat_base.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr char FLAT_MAGIC[8] = {'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0'};
+    constexpr uint32_t FLAT_VERSION = 1;
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr size_t SECTION_ALIGNMENT = 8;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t section_count;
+        uint32_t reserved;
+    };
+
+    struct SectionEntry {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    enum Section : uint32_t {
+        STOP_NAME_OFFSETS,
+        STOP_NAMES,
+        STOP_COORDINATES,
+        DISTANCES,
+        BUS_NAME_OFFSETS,
+        BUS_NAMES,
+        BUS_ROUNDTRIP,
+        ROUTE_OFFSETS,
+        ROUTE_STOPS,
+        BUS_STATS,
+        SETTINGS,
+        RENDER_SETTINGS,
+        GRAPH_EDGES,
+        HIERARCHY_RANKS,
+        HIERARCHY_EDGES,
+        SECTION_COUNT
+    };
+
+    struct FlatCoordinates {
+        double lat;
+        double lng;
+    };
+
+    struct FlatDistance {
+        uint32_t from;
+        uint32_t to;
+        int32_t distance;
+    };
+
+    struct FlatBusStat {
+        int32_t stops_in_route;
+        int32_t unique_stops;
+        double route_length;
+        double curvature;
+    };
+
+    struct FlatSettings {
+        int32_t bus_wait_time;
+        uint32_t graph_model;
+        double bus_velocity;
+        uint64_t vertex_count;
+        // 0 - иерархии в базе нет
+        uint32_t has_hierarchy;
+        uint32_t reserved;
+    };
+
+    struct FlatSpending {
+        int32_t stop_count;
+        uint32_t reserved;
+        double wait_time;
+        double trip_time;
+    };
+
+    struct FlatRouteEdge {
+        uint32_t from;
+        uint32_t to;
+        uint32_t from_stop;
+        uint32_t to_stop;
+        uint32_t bus;
+        uint32_t kind;
+        FlatSpending spending;
+    };
+
+    struct FlatHierarchyEdge {
+        uint32_t from;
+        uint32_t to;
+        uint32_t first;
+        // NO_SECOND - исходное ребро графа, не шорткат
+        uint32_t second;
+        FlatSpending weight;
+    };
+
+    constexpr uint32_t NO_SECOND = UINT32_MAX;
+
+    static_assert(sizeof(Header) == 24 && sizeof(SectionEntry) == 16);
+    static_assert(sizeof(FlatCoordinates) == 16 && sizeof(FlatDistance) == 12 && sizeof(FlatBusStat) == 24);
+    static_assert(sizeof(FlatSettings) == 32 && sizeof(FlatSpending) == 24);
+    static_assert(sizeof(FlatRouteEdge) == 48 && sizeof(FlatHierarchyEdge) == 40);
+
+    FlatSpending SaveSpending(const transport::TripSpending &spending) {
+        return {spending.stop_count, 0, spending.wait_time, spending.trip_time};
+    }
+
+    transport::TripSpending LoadSpending(const FlatSpending &spending) {
+        return {spending.stop_count, spending.wait_time, spending.trip_time};
+    }
+
+    // Секции копятся в одном буфере, каждая с выровненного смещения
+    class SectionWriter {
+    public:
+        SectionWriter() : entries_(SECTION_COUNT, SectionEntry{0, 0}) {
+        }
+
+        template<typename T>
+        void Add(Section section, const std::vector<T> &items) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Add(section, items.data(), items.size() * sizeof(T));
+        }
+
+        void Add(Section section, const void *data, size_t size) {
+            body_.resize((body_.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT, '\0');
+            entries_[section] = {body_.size(), size};
+            body_.append(static_cast<const char *>(data), size);
+        }
+
+        void Write(std::ostream &out) const {
+            Header header{};
+            std::memcpy(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+            header.version = FLAT_VERSION;
+            header.byte_order = BYTE_ORDER_MARK;
+            header.section_count = SECTION_COUNT;
+            // смещения в таблице - от начала файла
+            const uint64_t body_offset = sizeof(Header) + sizeof(SectionEntry) * entries_.size();
+            std::vector<SectionEntry> entries = entries_;
+            for (auto &entry : entries) {
+                entry.offset += body_offset;
+            }
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(entries.data()),
+                      static_cast<std::streamsize>(entries.size() * sizeof(SectionEntry)));
+            out.write(body_.data(), static_cast<std::streamsize>(body_.size()));
+        }
+
+    private:
+        std::vector<SectionEntry> entries_;
+        std::string body_;
+    };
+
+    // Имена подряд в одном буфере: у i-го это names[offsets[i] .. offsets[i + 1])
+    template<typename GetName>
+    void AddNames(SectionWriter &writer, Section offsets_section, Section names_section, size_t count,
+                  GetName get_name) {
+        std::vector<uint32_t> offsets{0};
+        std::string names;
+        for (size_t i = 0; i < count; ++i) {
+            names += get_name(i);
+            offsets.push_back(static_cast<uint32_t>(names.size()));
+        }
+        writer.Add(offsets_section, offsets);
+        writer.Add(names_section, names.data(), names.size());
+    }
+} // namespace
+
+void Handbook::Control::SaveFlatBase(const std::string &path, const FlatBaseContent &content) {
+    const Data::TransportCatalogue &catalogue = *content.catalogue;
+    const transport::RouteFinder::Data &route_data = *content.route_data;
+    const size_t stop_count = catalogue.GetStopCount();
+    const size_t bus_count = catalogue.GetBusCount();
+    SectionWriter writer;
+
+    AddNames(writer, STOP_NAME_OFFSETS, STOP_NAMES, stop_count,
+             [&catalogue](size_t id) -> const std::string & { return catalogue.GetStop(id)->name; });
+    std::vector<FlatCoordinates> coordinates;
+    coordinates.reserve(stop_count);
+    for (Data::StopId id = 0; id < stop_count; ++id) {
+        const auto &point = catalogue.GetStopCoordinates(id);
+        coordinates.push_back({point.lat, point.lng});
+    }
+    writer.Add(STOP_COORDINATES, coordinates);
+
+    std::vector<FlatDistance> distances;
+    for (const auto &[stops, distance] : catalogue.AllStopsDistances()) {
+        distances.push_back({stops.first->id, stops.second->id, distance});
+    }
+    writer.Add(DISTANCES, distances);
+
+    // автобусы по порядку BusId: при загрузке id те же, и статистика ложится на свои места
+    AddNames(writer, BUS_NAME_OFFSETS, BUS_NAMES, bus_count,
+             [&catalogue](size_t id) -> const std::string & { return catalogue.GetBus(id)->name; });
+    std::vector<uint8_t> roundtrip;
+    std::vector<uint32_t> route_offsets{0};
+    std::vector<uint32_t> route_stops;
+    std::vector<FlatBusStat> stats;
+    for (Data::BusId id = 0; id < bus_count; ++id) {
+        roundtrip.push_back(catalogue.GetBus(id)->is_roundtrip ? 1 : 0);
+        const auto route = catalogue.GetRouteStops(id);
+        route_stops.insert(route_stops.end(), route.begin(), route.end());
+        route_offsets.push_back(static_cast<uint32_t>(route_stops.size()));
+        const auto &stat = catalogue.GetBusStat(id);
+        stats.push_back({stat.stops_in_route, stat.unique_stops, stat.route_length, stat.curvature});
+    }
+    writer.Add(BUS_ROUNDTRIP, roundtrip);
+    writer.Add(ROUTE_OFFSETS, route_offsets);
+    writer.Add(ROUTE_STOPS, route_stops);
+    writer.Add(BUS_STATS, stats);
+
+    const FlatSettings settings{content.bus_wait_time,
+                                static_cast<uint32_t>(route_data.model),
+                                content.bus_velocity,
+                                route_data.vertex_count,
+                                route_data.hierarchy ? 1u : 0u,
+                                0};
+    writer.Add(SETTINGS, &settings, sizeof(settings));
+    writer.Add(RENDER_SETTINGS, content.render_settings.data(), content.render_settings.size());
+
+    std::vector<FlatRouteEdge> edges;
+    edges.reserve(route_data.edges.size());
+    for (const auto &edge : route_data.edges) {
+        edges.push_back({static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to),
+                         static_cast<uint32_t>(edge.from_stop), static_cast<uint32_t>(edge.to_stop),
+                         static_cast<uint32_t>(edge.bus), static_cast<uint32_t>(edge.kind),
+                         SaveSpending(edge.spending)});
+    }
+    writer.Add(GRAPH_EDGES, edges);
+
+    if (route_data.hierarchy) {
+        using Hierarchy = transport::RouteFinder::Hierarchy;
+        std::vector<uint32_t> ranks(route_data.hierarchy->ranks.begin(), route_data.hierarchy->ranks.end());
+        writer.Add(HIERARCHY_RANKS, ranks);
+        std::vector<FlatHierarchyEdge> hierarchy_edges;
+        hierarchy_edges.reserve(route_data.hierarchy->edges.size());
+        for (const auto &edge : route_data.hierarchy->edges) {
+            hierarchy_edges.push_back({static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to),
+                                       static_cast<uint32_t>(edge.first),
+                                       edge.second == Hierarchy::NO_EDGE ? NO_SECOND
+                                                                         : static_cast<uint32_t>(edge.second),
+                                       SaveSpending(edge.weight)});
+        }
+        writer.Add(HIERARCHY_EDGES, hierarchy_edges);
+    }
+
+    std::ofstream ofs(path, std::ios_base::out | std::ios_base::binary);
+    writer.Write(ofs);
+}
+
+bool Handbook::Control::IsFlatBase(const std::string &path) {
+    std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+    char magic[sizeof(FLAT_MAGIC)] = {};
+    ifs.read(magic, sizeof(magic));
+    return ifs && std::memcmp(magic, FLAT_MAGIC, sizeof(magic)) == 0;
+}
+
+Handbook::Control::FlatBase::FlatBase(const std::string &path) {
+#ifdef __unix__
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("Can't open flat base " + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data_ = static_cast<const char *>(mapping);
+            size_ = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    close(fd);
+#endif
+    if (data_ == nullptr) {
+        std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+        buffer_.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+    try {
+        CheckLayout();
+    } catch (...) {
+        Unmap();
+        throw;
+    }
+}
+
+Handbook::Control::FlatBase::~FlatBase() {
+    Unmap();
+}
+
+void Handbook::Control::FlatBase::Unmap() {
+#ifdef __unix__
+    if (data_ != nullptr && buffer_.empty()) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void Handbook::Control::FlatBase::CheckLayout() const {
+    Header header{};
+    if (size_ < sizeof(Header)) {
+        throw std::invalid_argument("Broken flat base: no header");
+    }
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0) {
+        throw std::invalid_argument("Not a flat base");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        throw std::invalid_argument("Flat base was written with a different byte order");
+    }
+    if (header.version != FLAT_VERSION || header.section_count != SECTION_COUNT) {
+        throw std::invalid_argument("Unsupported flat base version");
+    }
+    if (size_ < sizeof(Header) + sizeof(SectionEntry) * SECTION_COUNT) {
+        throw std::invalid_argument("Broken flat base: no section table");
+    }
+    const auto *entries = reinterpret_cast<const SectionEntry *>(data_ + sizeof(Header));
+    for (uint32_t section = 0; section < SECTION_COUNT; ++section) {
+        const SectionEntry &entry = entries[section];
+        if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > size_ || entry.size > size_ - entry.offset) {
+            throw std::invalid_argument("Broken flat base: section out of file");
+        }
+    }
+    if (entries[SETTINGS].size != sizeof(FlatSettings)) {
+        throw std::invalid_argument("Broken flat base: settings");
+    }
+}
+
+std::string_view Handbook::Control::FlatBase::GetBytes(uint32_t section) const {
+    const auto *entries = reinterpret_cast<const SectionEntry *>(data_ + sizeof(Header));
+    return {data_ + entries[section].offset, static_cast<size_t>(entries[section].size)};
+}
+
+template<typename T>
+Handbook::Control::FlatBase::Table<T> Handbook::Control::FlatBase::GetTable(uint32_t section) const {
+    const std::string_view bytes = GetBytes(section);
+    if (bytes.size() % sizeof(T) != 0) {
+        throw std::invalid_argument("Broken flat base: section size");
+    }
+    return {reinterpret_cast<const T *>(bytes.data()), bytes.size() / sizeof(T)};
+}
+
+void Handbook::Control::FlatBase::LoadCatalogue(Data::TransportCatalogue *catalogue) const {
+    const auto stop_name_offsets = GetTable<uint32_t>(STOP_NAME_OFFSETS);
+    const std::string_view stop_names = GetBytes(STOP_NAMES);
+    const auto coordinates = GetTable<FlatCoordinates>(STOP_COORDINATES);
+    if (stop_name_offsets.size != coordinates.size + 1 || stop_name_offsets[coordinates.size] > stop_names.size()) {
+        throw std::invalid_argument("Broken flat base: stops");
+    }
+    for (size_t id = 0; id < coordinates.size; ++id) {
+        catalogue->AddStop(stop_names.substr(stop_name_offsets[id], stop_name_offsets[id + 1] - stop_name_offsets[id]),
+                           {coordinates[id].lat, coordinates[id].lng});
+    }
+
+    const auto distances = GetTable<FlatDistance>(DISTANCES);
+    catalogue->ReserveStopsDistances(distances.size);
+    for (const auto &distance : distances) {
+        if (distance.from >= coordinates.size || distance.to >= coordinates.size) {
+            throw std::invalid_argument("Broken flat base: distances");
+        }
+        catalogue->AddStopsDistance(catalogue->GetStop(distance.from), catalogue->GetStop(distance.to),
+                                    distance.distance);
+    }
+
+    const auto bus_name_offsets = GetTable<uint32_t>(BUS_NAME_OFFSETS);
+    const std::string_view bus_names = GetBytes(BUS_NAMES);
+    const auto roundtrip = GetTable<uint8_t>(BUS_ROUNDTRIP);
+    const auto route_offsets = GetTable<uint32_t>(ROUTE_OFFSETS);
+    const auto route_stops = GetTable<uint32_t>(ROUTE_STOPS);
+    const auto stats = GetTable<FlatBusStat>(BUS_STATS);
+    const size_t bus_count = roundtrip.size;
+    if (bus_name_offsets.size != bus_count + 1 || route_offsets.size != bus_count + 1 || stats.size != bus_count ||
+        bus_name_offsets[bus_count] > bus_names.size() || route_offsets[bus_count] > route_stops.size) {
+        throw std::invalid_argument("Broken flat base: buses");
+    }
+    for (size_t id = 0; id < bus_count; ++id) {
+        if (route_offsets[id] > route_offsets[id + 1]) {
+            throw std::invalid_argument("Broken flat base: buses");
+        }
+        std::vector<Data::StopId> stops(route_stops.begin() + route_offsets[id],
+                                        route_stops.begin() + route_offsets[id + 1]);
+        for (const Data::StopId stop : stops) {
+            if (stop >= coordinates.size) {
+                throw std::invalid_argument("Broken flat base: route stops");
+            }
+        }
+        catalogue->AddBus(bus_names.substr(bus_name_offsets[id], bus_name_offsets[id + 1] - bus_name_offsets[id]),
+                          std::move(stops), roundtrip[id] != 0);
+    }
+
+    std::vector<Data::BusStat> bus_stats;
+    bus_stats.reserve(bus_count);
+    for (const auto &stat : stats) {
+        bus_stats.push_back({stat.stops_in_route, stat.unique_stops, stat.route_length, stat.curvature});
+    }
+    catalogue->LoadBusStats(std::move(bus_stats));
+}
+
+int Handbook::Control::FlatBase::GetBusWaitTime() const {
+    return GetTable<FlatSettings>(SETTINGS)[0].bus_wait_time;
+}
+
+double Handbook::Control::FlatBase::GetBusVelocity() const {
+    return GetTable<FlatSettings>(SETTINGS)[0].bus_velocity;
+}
+
+std::string_view Handbook::Control::FlatBase::GetRenderSettings() const {
+    return GetBytes(RENDER_SETTINGS);
+}
+
+transport::RouteFinder::Data Handbook::Control::FlatBase::GetRouteData() const {
+    using Hierarchy = transport::RouteFinder::Hierarchy;
+    const auto settings = GetTable<FlatSettings>(SETTINGS);
+    if (settings[0].graph_model > static_cast<uint32_t>(transport::GraphModel::RideVertices)) {
+        throw std::invalid_argument("Broken flat base: graph model");
+    }
+    transport::RouteFinder::Data data;
+    data.model = static_cast<transport::GraphModel>(settings[0].graph_model);
+    data.vertex_count = settings[0].vertex_count;
+    const auto edges = GetTable<FlatRouteEdge>(GRAPH_EDGES);
+    data.edges.reserve(edges.size);
+    for (const auto &edge : edges) {
+        if (edge.kind > static_cast<uint32_t>(transport::RouteFinder::EdgeKind::Alight)) {
+            throw std::invalid_argument("Broken flat base: edge kind");
+        }
+        data.edges.push_back({edge.from, edge.to, edge.from_stop, edge.to_stop, edge.bus, LoadSpending(edge.spending),
+                              static_cast<transport::RouteFinder::EdgeKind>(edge.kind)});
+    }
+    if (settings[0].has_hierarchy != 0) {
+        auto &hierarchy = data.hierarchy.emplace();
+        const auto ranks = GetTable<uint32_t>(HIERARCHY_RANKS);
+        hierarchy.ranks.assign(ranks.begin(), ranks.end());
+        const auto hierarchy_edges = GetTable<FlatHierarchyEdge>(HIERARCHY_EDGES);
+        hierarchy.edges.reserve(hierarchy_edges.size);
+        for (const auto &edge : hierarchy_edges) {
+            hierarchy.edges.push_back({edge.from, edge.to, LoadSpending(edge.weight), edge.first,
+                                       edge.second == NO_SECOND ? Hierarchy::NO_EDGE : edge.second});
+        }
+    }
+    return data;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Handbook {
+    namespace Control {
+        // Плоский формат базы - альтернатива protobuf (serialization_settings.format = "flat").
+        // Заголовок, таблица секций {смещение, размер} и сами секции - массивы структур фиксированной
+        // раскладки, выровненные на 8 байт. Порядок байт - как у машины, на которой база собрана.
+        // Файл отображается в память, но справочник своих данных не отдаёт: LoadCatalogue копирует
+        // таблицы через AddStop/AddStopsDistance/AddBus, только без разбора protobuf и поиска остановок
+        // по именам. Статистика автобусов загружается готовой, а не пересчитывается; граф и иерархия
+        // читаются из файла, лишь когда строится маршрутизатор. Настройки отрисовки лежат
+        // сериализованным protodata::RenderSettings и разбираются как protobuf
+        struct FlatBaseContent {
+            const Data::TransportCatalogue *catalogue = nullptr;
+            int bus_wait_time = 0;
+            double bus_velocity = 0;
+            // настройки отрисовки сериализованным protodata::RenderSettings
+            std::string render_settings;
+            const transport::RouteFinder::Data *route_data = nullptr;
+        };
+
+        void SaveFlatBase(const std::string &path, const FlatBaseContent &content);
+
+        // Файл начинается с сигнатуры плоской базы
+        bool IsFlatBase(const std::string &path);
+
+        class FlatBase {
+        public:
+            // Отображает файл в память; не та сигнатура, версия или битые секции - std::invalid_argument
+            explicit FlatBase(const std::string &path);
+
+            FlatBase(const FlatBase &) = delete;
+
+            FlatBase &operator=(const FlatBase &) = delete;
+
+            ~FlatBase();
+
+            // Остановки, расстояния, автобусы и их статистика - в пустой справочник
+            void LoadCatalogue(Data::TransportCatalogue *catalogue) const;
+
+            int GetBusWaitTime() const;
+
+            double GetBusVelocity() const;
+
+            std::string_view GetRenderSettings() const;
+
+            transport::RouteFinder::Data GetRouteData() const;
+
+        private:
+            template<typename T>
+            struct Table {
+                const T *data = nullptr;
+                size_t size = 0;
+
+                const T *begin() const {
+                    return data;
+                }
+
+                const T *end() const {
+                    return data + size;
+                }
+
+                const T &operator[](size_t index) const {
+                    return data[index];
+                }
+            };
+
+            template<typename T>
+            Table<T> GetTable(uint32_t section) const;
+
+            std::string_view GetBytes(uint32_t section) const;
+
+            void CheckLayout() const;
+
+            void Unmap();
+
+            const char *data_ = nullptr;
+            size_t size_ = 0;
+            // без mmap файл читается сюда целиком
+            std::vector<char> buffer_;
+        };
+    } // namespace Control
+} // namespace Handbook
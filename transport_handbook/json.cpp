@@ -1,9 +1,35 @@
 #include "json.h"
 
 #include <iterator>
+#include <sstream>
 
 namespace json {
 
+    void PrintString(std::string_view value, std::ostream &out) {
+        using namespace std::literals;
+        out.put('"');
+        for (const char c : value) {
+            switch (c) {
+                case '\r':
+                    out << "\\r"sv;
+                    break;
+                case '\n':
+                    out << "\\n"sv;
+                    break;
+                case '"':
+                    // Символы " и \ выводятся как \" или \\, соответственно
+                    [[fallthrough]];
+                case '\\':
+                    out.put('\\');
+                    [[fallthrough]];
+                default:
+                    out.put(c);
+                    break;
+            }
+        }
+        out.put('"');
+    }
+
     namespace {
         using namespace std::literals;
 
@@ -248,35 +274,17 @@ namespace json {
             ctx.out << value;
         }
 
-        void PrintString(const std::string &value, std::ostream &out) {
-            out.put('"');
-            for (const char c : value) {
-                switch (c) {
-                    case '\r':
-                        out << "\\r"sv;
-                        break;
-                    case '\n':
-                        out << "\\n"sv;
-                        break;
-                    case '"':
-                        // Символы " и \ выводятся как \" или \\, соответственно
-                        [[fallthrough]];
-                    case '\\':
-                        out.put('\\');
-                        [[fallthrough]];
-                    default:
-                        out.put(c);
-                        break;
-                }
-            }
-            out.put('"');
-        }
 
         template<>
         void PrintValue<std::string>(const std::string &value, const PrintContext &ctx) {
             PrintString(value, ctx.out);
         }
 
+        template<>
+        void PrintValue<RawJson>(const RawJson &value, const PrintContext &ctx) {
+            ctx.out << *value.text;
+        }
+
         template<>
         void PrintValue<std::nullptr_t>(const std::nullptr_t &, const PrintContext &ctx) {
             ctx.out << "null"sv;
@@ -347,4 +355,10 @@ namespace json {
         PrintNode(doc.GetRoot(), PrintContext{output});
     }
 
+    RawJson MakeRawString(const std::string &value) {
+        std::ostringstream out;
+        PrintString(value, out);
+        return RawJson{std::make_shared<const std::string>(out.str())};
+    }
+
 } // namespace json
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -18,7 +20,16 @@ namespace json {
         using runtime_error::runtime_error;
     };
 
-    class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+    // Готовый фрагмент JSON, выводится как есть. Текст общий для всех копий узла
+    struct RawJson {
+        std::shared_ptr<const std::string> text;
+
+        bool operator==(const RawJson &rhs) const {
+            return text == rhs.text || (text && rhs.text && *text == *rhs.text);
+        }
+    };
+
+    class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, RawJson> {
     public:
         using variant::variant;
         using Value = variant;
@@ -107,6 +118,10 @@ namespace json {
             return std::get<std::string>(*this);
         }
 
+        bool IsRawJson() const {
+            return std::holds_alternative<RawJson>(*this);
+        }
+
         bool IsDict() const {
             return std::holds_alternative<Dict>(*this);
         }
@@ -167,4 +182,10 @@ namespace json {
 
     void Print(const Document &doc, std::ostream &output);
 
+    // Строка в кавычках с экранированием, как её выводит Print
+    void PrintString(std::string_view value, std::ostream &out);
+
+    // Строка, один раз экранированная и взятая в кавычки, для многократного вывода
+    RawJson MakeRawString(const std::string &value);
+
 } // namespace json
\ No newline at end of file
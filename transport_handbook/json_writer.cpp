@@ -0,0 +1,146 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+static constexpr int INDENT_STEP = 4;
+
+json::Writer::Writer(std::ostream &out, size_t depth) : out_(out), depth_(depth) {
+}
+
+json::Writer::Writer(std::ostream &out, Layout layout) : out_(out), depth_(0), layout_(layout) {
+}
+
+json::Writer &json::Writer::Key(std::string_view key) {
+    using namespace std;
+    if (levels_.empty() || !levels_.back().is_dict) {
+        throw std::logic_error("[Key] not in a dict node"s);
+    }
+    Level &level = levels_.back();
+    if (level.has_key) {
+        throw std::logic_error("[Key] repeat sequence"s);
+    }
+    if (level.first) {
+        level.first = false;
+    } else {
+        PrintSeparator();
+    }
+    PrintIndent();
+    PrintString(key, out_);
+    out_ << (layout_ == Layout::Pretty ? ": "sv : ":"sv);
+    level.has_key = true;
+    return *this;
+}
+
+json::Writer &json::Writer::Value(int value) {
+    BeginValue();
+    out_ << value;
+    return *this;
+}
+
+json::Writer &json::Writer::Value(double value) {
+    BeginValue();
+    out_ << value;
+    return *this;
+}
+
+json::Writer &json::Writer::Value(bool value) {
+    using namespace std;
+    BeginValue();
+    out_ << (value ? "true"sv : "false"sv);
+    return *this;
+}
+
+json::Writer &json::Writer::Value(std::string_view value) {
+    BeginValue();
+    PrintString(value, out_);
+    return *this;
+}
+
+json::Writer &json::Writer::Value(const char *value) {
+    return Value(std::string_view(value));
+}
+
+json::Writer &json::Writer::Value(const RawJson &value) {
+    BeginValue();
+    out_ << *value.text;
+    return *this;
+}
+
+json::Writer &json::Writer::StartDict() {
+    Open(true, '{');
+    return *this;
+}
+
+json::Writer &json::Writer::EndDict() {
+    Close(true, '}');
+    return *this;
+}
+
+json::Writer &json::Writer::StartArray() {
+    Open(false, '[');
+    return *this;
+}
+
+json::Writer &json::Writer::EndArray() {
+    Close(false, ']');
+    return *this;
+}
+
+void json::Writer::BeginValue() {
+    using namespace std;
+    if (levels_.empty()) {
+        return;
+    }
+    Level &level = levels_.back();
+    if (level.is_dict) {
+        if (!level.has_key) {
+            throw std::logic_error("[Value] dict value without a key"s);
+        }
+        level.has_key = false;
+        return;
+    }
+    if (level.first) {
+        level.first = false;
+    } else {
+        PrintSeparator();
+    }
+    PrintIndent();
+}
+
+void json::Writer::PrintSeparator() {
+    out_.put(',');
+    if (layout_ == Layout::Pretty) {
+        out_.put('\n');
+    }
+}
+
+void json::Writer::PrintIndent() {
+    if (layout_ == Layout::Compact) {
+        return;
+    }
+    for (size_t i = 0; i < (depth_ + levels_.size()) * INDENT_STEP; ++i) {
+        out_.put(' ');
+    }
+}
+
+void json::Writer::Open(bool is_dict, char bracket) {
+    BeginValue();
+    out_.put(bracket);
+    if (layout_ == Layout::Pretty) {
+        out_.put('\n');
+    }
+    levels_.push_back({is_dict});
+}
+
+void json::Writer::Close(bool is_dict, char bracket) {
+    using namespace std;
+    if (levels_.empty() || levels_.back().is_dict != is_dict || levels_.back().has_key) {
+        throw std::logic_error(is_dict ? "[EndDict] not in a dict node"s : "[EndArray] not in an array node"s);
+    }
+    levels_.pop_back();
+    if (layout_ == Layout::Pretty) {
+        out_.put('\n');
+        PrintIndent();
+    }
+    out_.put(bracket);
+}
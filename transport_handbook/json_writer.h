@@ -0,0 +1,73 @@
+#pragma once
+
+#include "json.h"
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+    // Пишет JSON сразу в поток, без дерева Node, байт в байт как json::Print.
+    // Print выводит Dict по возрастанию ключей, поэтому и сюда ключи подаются по возрастанию
+    class Writer {
+    public:
+        // Compact - без переводов строк и отступов, весь документ в одну строку (NDJSON)
+        enum class Layout {
+            Pretty,
+            Compact
+        };
+
+        // depth - вложенность, с которой начинается вывод: ответ, который потом встанет
+        // элементом массива верхнего уровня, пишется с depth = 1
+        explicit Writer(std::ostream &out, size_t depth = 0);
+
+        Writer(std::ostream &out, Layout layout);
+
+        Writer &Key(std::string_view key);
+
+        Writer &Value(int value);
+
+        Writer &Value(double value);
+
+        Writer &Value(bool value);
+
+        Writer &Value(std::string_view value);
+
+        // иначе строковый литерал ушёл бы в Value(bool)
+        Writer &Value(const char *value);
+
+        Writer &Value(const RawJson &value);
+
+        Writer &StartDict();
+
+        Writer &EndDict();
+
+        Writer &StartArray();
+
+        Writer &EndArray();
+
+    private:
+        struct Level {
+            bool is_dict = false;
+            bool first = true;
+            bool has_key = false;
+        };
+
+        // разделитель и отступ перед элементом массива; в словаре их уже вывел Key
+        void BeginValue();
+
+        void PrintSeparator();
+
+        void PrintIndent();
+
+        void Open(bool is_dict, char bracket);
+
+        void Close(bool is_dict, char bracket);
+
+        std::ostream &out_;
+        size_t depth_;
+        Layout layout_ = Layout::Pretty;
+        std::vector<Level> levels_;
+    };
+
+} // namespace json
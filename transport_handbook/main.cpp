@@ -3,6 +3,7 @@
 #include <string_view>
 #include "domain.h"
 #include "serialization.h"
+#include "server.h"
 #include "request_handler.h"
 #include "sstream"
 #include "transport_catalogue.h"
@@ -10,7 +11,7 @@
 using namespace std::literals;
 
 void PrintUsage(std::ostream &stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve]\n"sv;
 }
 
 int main(int argc, char *argv[]) {
@@ -30,6 +31,9 @@ int main(int argc, char *argv[]) {
                 std::make_unique<Handbook::Data::TransportCatalogue>();
         Handbook::Control::Deserializer deserializer(std::cin, transport_catalogue.get());
         deserializer.PrintReport();
+    } else if (mode == "serve"sv) {
+        Handbook::Control::Server server(std::cin, std::cout);
+        server.Run();
     } else {
         PrintUsage();
         return 1;
@@ -11,13 +11,13 @@ bool Handbook::Renderer::IsZero(double value) {
 }
 
 namespace {
-    static std::map<std::string_view, Handbook::Data::StopPtr> GetUniqueStopsByName(
-            const Handbook::Renderer::BusesByName &buses) {
-        std::map<std::string_view, Handbook::Data::StopPtr> stops;
+    static Handbook::Renderer::StopCoordinatesByName GetUniqueStopsByName(
+            const Handbook::Data::TransportCatalogue &catalogue, const Handbook::Renderer::BusesByName &buses) {
+        Handbook::Renderer::StopCoordinatesByName stops;
 
         for (const auto&[_, bus] : buses) {
-            for (const auto stop : bus->stops) {
-                stops.emplace(stop->name, stop);
+            for (const auto stop : catalogue.GetRouteStops(bus->id)) {
+                stops.emplace(catalogue.GetStop(stop)->name, catalogue.GetStopCoordinates(stop));
             }
         }
 
@@ -25,15 +25,16 @@ namespace {
     }
 } // namespace
 
-void Handbook::Renderer::Map::Render(const BusesByName &buses_by_name, std::ostream &out) const {
-    const auto unique_stops = ::GetUniqueStopsByName(buses_by_name);
+void Handbook::Renderer::Map::Render(const Handbook::Data::TransportCatalogue &catalogue,
+                                     const BusesByName &buses_by_name, std::ostream &out) const {
+    const auto unique_stops = ::GetUniqueStopsByName(catalogue, buses_by_name);
     if (unique_stops.empty()) {
         return;
     }
 
     std::unordered_set<Handbook::Utilities::Coordinates, Handbook::Utilities::CoordinatesHash> coordinates;
     for (const auto stop : unique_stops) {
-        coordinates.insert(stop.second->coordinates);
+        coordinates.insert(stop.second);
     }
 
     SphereProjector projector(coordinates.begin(), coordinates.end(), render_props_.width, render_props_.height,
@@ -41,8 +42,8 @@ void Handbook::Renderer::Map::Render(const BusesByName &buses_by_name, std::ostr
 
     svg::Document document;
 
-    DrawLineOfRoad(document, projector, buses_by_name);
-    DrawBusTitles(document, projector, buses_by_name);
+    DrawLineOfRoad(document, projector, catalogue, buses_by_name);
+    DrawBusTitles(document, projector, catalogue, buses_by_name);
     DrawStops(document, projector, unique_stops);
     DrawStopTitles(document, projector, unique_stops);
 
@@ -51,14 +52,17 @@ void Handbook::Renderer::Map::Render(const BusesByName &buses_by_name, std::ostr
 
 void Handbook::Renderer::Map::DrawLineOfRoad(svg::Document &document,
                                              const Handbook::Renderer::SphereProjector &projector,
+                                             const Handbook::Data::TransportCatalogue &catalogue,
                                              const BusesByName &buses) const {
     using namespace std;
     int i = 0;
     for (const auto&[_, bus] : buses) {
-        std::vector<const Handbook::Data::Stop *> stop_ptrs = {bus->stops.begin(), bus->stops.end()};
+        const auto route = catalogue.GetRouteStops(bus->id);
+        std::vector<Handbook::Data::StopId> stop_ids = {route.begin(), route.end()};
 
         if (!bus->is_roundtrip) {
-            stop_ptrs.insert(stop_ptrs.end(), next(bus->stops.rbegin()), bus->stops.rend());
+            stop_ids.insert(stop_ids.end(), next(make_reverse_iterator(route.end())),
+                            make_reverse_iterator(route.begin()));
         }
 
         size_t color_index = i % render_props_.color_palette.size();
@@ -70,8 +74,8 @@ void Handbook::Renderer::Map::DrawLineOfRoad(svg::Document &document,
                 .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                 .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-        for (const auto stop : stop_ptrs) {
-            polyline.AddPoint(projector(stop->coordinates));
+        for (const auto stop : stop_ids) {
+            polyline.AddPoint(projector(catalogue.GetStopCoordinates(stop)));
         }
 
         document.Add(polyline);
@@ -81,18 +85,21 @@ void Handbook::Renderer::Map::DrawLineOfRoad(svg::Document &document,
 
 void Handbook::Renderer::Map::DrawBusTitles(svg::Document &document,
                                             const Handbook::Renderer::SphereProjector &projector,
+                                            const Handbook::Data::TransportCatalogue &catalogue,
                                             const BusesByName &buses) const {
     int i = 0;
     for (const auto&[name, bus] : buses) {
         size_t color_index = i % render_props_.color_palette.size();
 
-        std::vector<Handbook::Data::StopPtr> end_stops = {bus->stops.front()};
-        if (!bus->is_roundtrip && bus->stops.back() != bus->stops.front()) {
-            end_stops.emplace_back(bus->stops.back());
+        const auto route = catalogue.GetRouteStops(bus->id);
+        std::vector<Handbook::Data::StopId> end_stops = {route[0]};
+        if (!bus->is_roundtrip && route[route.size() - 1] != route[0]) {
+            end_stops.emplace_back(route[route.size() - 1]);
         }
 
         for (const auto stop : end_stops) {
-            DrawBusTitle(document, name, projector(stop->coordinates), render_props_.color_palette[color_index]);
+            DrawBusTitle(document, name, projector(catalogue.GetStopCoordinates(stop)),
+                         render_props_.color_palette[color_index]);
         }
 
         ++i;
@@ -125,19 +132,19 @@ void Handbook::Renderer::Map::DrawBusTitle(svg::Document &document, std::string_
 }
 
 void Handbook::Renderer::Map::DrawStops(svg::Document &document, const Handbook::Renderer::SphereProjector &projector,
-                                        const std::map<std::string_view, Handbook::Data::StopPtr> &stops) const {
-    for (const auto&[name, stop] : stops) {
+                                        const StopCoordinatesByName &stops) const {
+    for (const auto&[name, coordinates] : stops) {
         svg::Circle circle;
         document.Add(
                 circle.SetRadius(render_props_.stop_radius).SetFillColor("white"s).SetCenter(
-                        projector(stop->coordinates)));
+                        projector(coordinates)));
     }
 }
 
 void Handbook::Renderer::Map::DrawStopTitles(svg::Document &document,
                                              const Handbook::Renderer::SphereProjector &projector,
-                                             const std::map<std::string_view, Handbook::Data::StopPtr> &stops) const {
-    for (const auto&[name, stop] : stops) {
+                                             const StopCoordinatesByName &stops) const {
+    for (const auto&[name, coordinates] : stops) {
         svg::Text underlayer;
         document.Add(underlayer.SetData(std::string{name})
                              .SetFontFamily("Verdana"s)
@@ -147,7 +154,7 @@ void Handbook::Renderer::Map::DrawStopTitles(svg::Document &document,
                              .SetStrokeWidth(render_props_.underlayer_width)
                              .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                              .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                             .SetPosition(projector(stop->coordinates))
+                             .SetPosition(projector(coordinates))
                              .SetOffset(render_props_.stop_label_offset));
 
         svg::Text title;
@@ -155,7 +162,7 @@ void Handbook::Renderer::Map::DrawStopTitles(svg::Document &document,
                              .SetFontFamily("Verdana"s)
                              .SetFontSize(render_props_.stop_label_font_size)
                              .SetFillColor("black"s)
-                             .SetPosition(projector(stop->coordinates))
+                             .SetPosition(projector(coordinates))
                              .SetOffset(render_props_.stop_label_offset));
     }
 }
@@ -15,6 +15,7 @@ inline const double EPSILON = 1e-6;
 namespace Handbook {
     namespace Renderer {
         using BusesByName = std::map<std::string_view, Handbook::Data::BusPtr>;
+        using StopCoordinatesByName = std::map<std::string_view, Handbook::Utilities::Coordinates>;
         struct RenderSettings {
             double width = 0.0;
             double height = 0.0;
@@ -94,25 +95,27 @@ namespace Handbook {
                 render_props_ = std::move(props);
             }
 
-            void Render(const BusesByName &buses_by_name, std::ostream &out = std::cout) const;
+            // Маршруты и координаты остановок берутся из catalogue по id
+            void Render(const Handbook::Data::TransportCatalogue &catalogue, const BusesByName &buses_by_name,
+                        std::ostream &out = std::cout) const;
 
         private:
             RenderSettings render_props_;
 
             void DrawLineOfRoad(svg::Document &document, const SphereProjector &projector,
-                                const BusesByName &buses) const;
+                                const Handbook::Data::TransportCatalogue &catalogue, const BusesByName &buses) const;
 
             void DrawBusTitles(svg::Document &document, const SphereProjector &projector,
-                               const BusesByName &buses) const;
+                               const Handbook::Data::TransportCatalogue &catalogue, const BusesByName &buses) const;
 
             void DrawBusTitle(svg::Document &document, std::string_view name, svg::Point pos,
                               const svg::Color &color) const;
 
             void DrawStops(svg::Document &document, const SphereProjector &projector,
-                           const std::map<std::string_view, Handbook::Data::StopPtr> &stops) const;
+                           const StopCoordinatesByName &stops) const;
 
             void DrawStopTitles(svg::Document &document, const SphereProjector &projector,
-                                const std::map<std::string_view, Handbook::Data::StopPtr> &stops) const;
+                                const StopCoordinatesByName &stops) const;
         };
     } // namespace Renderer
 } // namespace Handbook
\ No newline at end of file
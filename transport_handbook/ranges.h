@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -23,6 +24,19 @@ namespace ranges {
             return end_;
         }
 
+        size_t size() const {
+            return std::distance(begin_, end_);
+        }
+
+        bool empty() const {
+            return begin_ == end_;
+        }
+
+        // только для итераторов произвольного доступа
+        decltype(auto) operator[](size_t index) const {
+            return begin_[index];
+        }
+
     private:
         It begin_;
         It end_;
@@ -17,7 +17,7 @@ static svg::Color ParsingColor(const json::Node &color) {
     return svg::Rgba(color_array[0].AsInt(), color_array[1].AsInt(), color_array[2].AsInt(), color_array[3].AsDouble());
 }
 
-static Handbook::Renderer::RenderSettings ReadRenderSettings(json::Dict data) {
+Handbook::Renderer::RenderSettings Handbook::Views::ReadRenderSettings(json::Dict data) {
     using namespace std;
     Handbook::Renderer::RenderSettings settings;
     settings.width = data["width"s].AsDouble();
@@ -39,31 +39,31 @@ static Handbook::Renderer::RenderSettings ReadRenderSettings(json::Dict data) {
     return settings;
 }
 
-static json::Node makePathAnswer(int requestId, const std::vector<const transport::TripItem *> &data) {
+static json::Node makePathAnswer(int requestId, const std::vector<transport::TripItem> &data) {
     using namespace std;
     json::Builder builder;
     builder.StartArray();
     double totalTime = 0.0;
     for (const auto &item : data) {
-        totalTime += (item->spending.wait_time + item->spending.trip_time);
+        totalTime += (item.spending.wait_time + item.spending.trip_time);
         builder.StartDict()
                 .Key("type"s)
                 .Value("Wait"s)
                 .Key("stop_name"s)
-                .Value(item->from->name)
+                .Value(item.from->name)
                 .Key("time"s)
-                .Value(item->spending.wait_time / 60)
+                .Value(item.spending.wait_time / 60)
                 .EndDict()
 
                 .StartDict()
                 .Key("type"s)
                 .Value("Bus"s)
                 .Key("bus"s)
-                .Value(item->bus->name)
+                .Value(item.bus->name)
                 .Key("span_count"s)
-                .Value(item->spending.stop_count)
+                .Value(item.spending.stop_count)
                 .Key("time"s)
-                .Value(item->spending.trip_time / 60)
+                .Value(item.spending.trip_time / 60)
                 .EndDict();
     }
     json::Node x = builder.EndArray().Build();
@@ -80,6 +80,130 @@ static json::Node makePathAnswer(int requestId, const std::vector<const transpor
             .Build();
 }
 
+static void writePathAnswer(json::Writer &writer, int requestId, const std::vector<transport::TripItem> &data) {
+    double totalTime = 0.0;
+    for (const auto &item : data) {
+        totalTime += (item.spending.wait_time + item.spending.trip_time);
+    }
+    writer.StartDict().Key("items").StartArray();
+    for (const auto &item : data) {
+        writer.StartDict()
+                .Key("stop_name")
+                .Value(item.from->name)
+                .Key("time")
+                .Value(item.spending.wait_time / 60)
+                .Key("type")
+                .Value("Wait")
+                .EndDict()
+
+                .StartDict()
+                .Key("bus")
+                .Value(item.bus->name)
+                .Key("span_count")
+                .Value(item.spending.stop_count)
+                .Key("time")
+                .Value(item.spending.trip_time / 60)
+                .Key("type")
+                .Value("Bus")
+                .EndDict();
+    }
+    writer.EndArray().Key("request_id").Value(requestId).Key("total_time").Value(totalTime / 60).EndDict();
+}
+
+static std::vector<std::string_view> stopsInBox(const json::Dict &request,
+                                               const Handbook::Data::TransportCatalogue *t_q) {
+    using namespace std;
+    std::vector<std::string_view> names;
+    for (const auto stop : t_q->FindStopsInBox(
+            {request.at("min_latitude"s).AsDouble(), request.at("min_longitude"s).AsDouble()},
+            {request.at("max_latitude"s).AsDouble(), request.at("max_longitude"s).AsDouble()})) {
+        names.push_back(t_q->GetStop(stop)->name);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static std::vector<Handbook::Data::StopSpatialIndex::Neighbour>
+nearestStops(const json::Dict &request, const Handbook::Data::TransportCatalogue *t_q) {
+    using namespace std;
+    const int count = request.at("count"s).AsInt();
+    if (count <= 0) {
+        return {};
+    }
+    return t_q->FindNearestStops({request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()},
+                                 static_cast<size_t>(count));
+}
+
+void Handbook::Views::WriteData(json::Writer &writer, const json::Dict &request,
+                                const Handbook::Data::TransportCatalogue *t_q, const transport::RouteFinder *r_f) {
+    using namespace std;
+    int id = request.at("id"s).AsInt();
+    const std::string &type = request.at("type"s).AsString();
+
+    if (type == "Bus"s) {
+        const Handbook::Data::Bus *bus = t_q->FindBus(request.at("name"s).AsString());
+        if (bus != nullptr) {
+            const auto &info = t_q->GetBusStat(bus);
+            writer.StartDict()
+                    .Key("curvature")
+                    .Value(info.curvature)
+                    .Key("request_id")
+                    .Value(id)
+                    .Key("route_length")
+                    .Value(info.route_length)
+                    .Key("stop_count")
+                    .Value(info.stops_in_route)
+                    .Key("unique_stop_count")
+                    .Value(info.unique_stops)
+                    .EndDict();
+            return;
+        }
+    } else if (type == "Stop"s) {
+        auto stop = t_q->FindStop(request.at("name"s).AsString());
+        if (stop) {
+            std::vector<std::string_view> buses;
+            for (const auto bus : t_q->GetBusesOnStop(stop->id)) {
+                buses.push_back(t_q->GetBus(bus)->name);
+            }
+            std::sort(buses.begin(), buses.end());
+            writer.StartDict().Key("buses").StartArray();
+            for (const auto bus : buses) {
+                writer.Value(bus);
+            }
+            writer.EndArray().Key("request_id").Value(id).EndDict();
+            return;
+        }
+    } else if (type == "NearestStops"s) {
+        writer.StartDict().Key("request_id").Value(id).Key("stops").StartArray();
+        for (const auto &[stop, distance] : nearestStops(request, t_q)) {
+            writer.StartDict().Key("distance").Value(distance).Key("name").Value(t_q->GetStop(stop)->name).EndDict();
+        }
+        writer.EndArray().EndDict();
+        return;
+    } else if (type == "StopsInBox"s) {
+        writer.StartDict().Key("request_id").Value(id).Key("stops").StartArray();
+        for (const auto name : stopsInBox(request, t_q)) {
+            writer.Value(name);
+        }
+        writer.EndArray().EndDict();
+        return;
+    } else if (type == "Map"s) {
+        WriteMapData(writer, id, RenderMap(t_q, ReadRenderSettings(request.at("render_settings").AsDict())));
+        return;
+    } else if (type == "Route" && r_f) {
+        auto path_info = r_f->findRoute(request.at("from"s).AsString(), request.at("to"s).AsString());
+        if (path_info.has_value()) {
+            writePathAnswer(writer, id, path_info.value());
+            return;
+        }
+    }
+    writer.StartDict().Key("error_message").Value("not found").Key("request_id").Value(id).EndDict();
+}
+
+void Handbook::Views::WriteMapData(json::Writer &writer, int id, const json::RawJson &map) {
+    writer.StartDict().Key("map").Value(map).Key("request_id").Value(id).EndDict();
+}
+
 json::Document Handbook::Views::GetData(const json::Document &stat, const Handbook::Data::TransportCatalogue *t_q,
                                         const transport::RouteFinder *r_f) {
     using namespace std;
@@ -92,7 +216,7 @@ json::Document Handbook::Views::GetData(const json::Document &stat, const Handbo
         std::string name = dict.at("name"s).AsString();
         const Handbook::Data::Bus *bus = t_q->FindBus(name);
         if (bus != nullptr) {
-            auto info = t_q->GetBusStat(bus);
+            const auto &info = t_q->GetBusStat(bus);
 
             result = json::Builder{}
                     .StartDict()
@@ -116,11 +240,11 @@ json::Document Handbook::Views::GetData(const json::Document &stat, const Handbo
         std::string name = dict.at("name"s).AsString();
         auto stop = t_q->FindStop(name);
         if (stop) {
-            auto info = t_q->GetBusesOnStop(stop);
-            if (!info->empty()) {
+            auto info = t_q->GetBusesOnStop(stop->id);
+            if (!info.empty()) {
                 std::vector<json::Node> buses;
-                for (const auto &item : *info) {
-                    buses.push_back(item->name);
+                for (const auto bus : info) {
+                    buses.push_back(t_q->GetBus(bus)->name);
                 }
                 std::sort(buses.begin(), buses.end(),
                           [](json::Node &l, json::Node &r) { return l.AsString() < r.AsString(); });
@@ -149,31 +273,23 @@ json::Document Handbook::Views::GetData(const json::Document &stat, const Handbo
                 return json::Document(result);
             }
         }
-    } else if (type == "Map"s) {
-
-        Handbook::Renderer::RenderSettings renderSettings = ReadRenderSettings(dict.at("render_settings").AsDict());
-
-        Handbook::Renderer::Map map_renderer(renderSettings);
-        Handbook::Renderer::BusesByName buses_by_name;
-
-        for (const auto &bus : t_q->GetBusesWithStops()) {
-            buses_by_name.emplace(bus->name, bus);
+    } else if (type == "NearestStops"s) {
+        json::Array stops;
+        for (const auto &[stop, distance] : nearestStops(dict, t_q)) {
+            stops.push_back(json::Dict{{"distance"s, distance},
+                                       {"name"s,     t_q->GetStop(stop)->name}});
         }
-
-        stringstream out;
-
-        map_renderer.Render(buses_by_name, out);
-
-        json::Node res = json::Builder{}
-                .StartDict()
-                .Key("request_id")
-                .Value(id)
-                .Key("map")
-                .Value(out.str())
-                .EndDict()
-                .Build()
-                .AsDict();
-        return json::Document(res);
+        return json::Document(json::Dict{{"request_id"s, id},
+                                         {"stops"s,      std::move(stops)}});
+    } else if (type == "StopsInBox"s) {
+        json::Array stops;
+        for (const auto name : stopsInBox(dict, t_q)) {
+            stops.push_back(std::string(name));
+        }
+        return json::Document(json::Dict{{"request_id"s, id},
+                                         {"stops"s,      std::move(stops)}});
+    } else if (type == "Map"s) {
+        return GetMapData(id, t_q, ReadRenderSettings(dict.at("render_settings").AsDict()));
     } else if (type == "Route" && r_f) {
         std::string f = dict.at("from"s).AsString();
         std::string t = dict.at("to"s).AsString();
@@ -186,3 +302,37 @@ json::Document Handbook::Views::GetData(const json::Document &stat, const Handbo
                         {"error_message"s, "not found"s}};
     return json::Document(result);
 }
+
+json::Document Handbook::Views::GetMapData(int id, const Handbook::Data::TransportCatalogue *t_q,
+                                           const Handbook::Renderer::RenderSettings &render_settings) {
+    return GetMapData(id, RenderMap(t_q, render_settings));
+}
+
+json::RawJson Handbook::Views::RenderMap(const Handbook::Data::TransportCatalogue *t_q,
+                                         const Handbook::Renderer::RenderSettings &render_settings) {
+    Handbook::Renderer::Map map_renderer(render_settings);
+    Handbook::Renderer::BusesByName buses_by_name;
+
+    for (const auto &bus : t_q->GetBusesWithStops()) {
+        buses_by_name.emplace(bus->name, bus);
+    }
+
+    std::stringstream out;
+
+    map_renderer.Render(*t_q, buses_by_name, out);
+
+    return json::MakeRawString(out.str());
+}
+
+json::Document Handbook::Views::GetMapData(int id, const json::RawJson &map) {
+    json::Node res = json::Builder{}
+            .StartDict()
+            .Key("request_id")
+            .Value(id)
+            .Key("map")
+            .Value(map)
+            .EndDict()
+            .Build()
+            .AsDict();
+    return json::Document(res);
+}
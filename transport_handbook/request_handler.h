@@ -1,6 +1,8 @@
 #pragma once
 
 #include "json.h"
+#include "json_writer.h"
+#include "map_renderer.h"
 #include "transport_router.h"
 #include "transport_catalogue.h"
 #include <string>
@@ -9,5 +11,24 @@ namespace Handbook {
     namespace Views {
         json::Document GetData(const json::Document &stat, const Handbook::Data::TransportCatalogue *t_q,
                                const transport::RouteFinder *r_f);
+
+        // Тот же ответ, что у GetData, сразу в writer, без дерева json::Node
+        void WriteData(json::Writer &writer, const json::Dict &request, const Handbook::Data::TransportCatalogue *t_q,
+                       const transport::RouteFinder *r_f);
+
+        void WriteMapData(json::Writer &writer, int id, const json::RawJson &map);
+
+        // Map с готовыми настройками, без разбора JSON
+        json::Document GetMapData(int id, const Handbook::Data::TransportCatalogue *t_q,
+                                  const Handbook::Renderer::RenderSettings &render_settings);
+
+        // Карта целиком, уже экранированная строка JSON: справочник после загрузки не меняется,
+        // поэтому её можно отрисовать один раз и отдавать на каждый Map
+        json::RawJson RenderMap(const Handbook::Data::TransportCatalogue *t_q,
+                                const Handbook::Renderer::RenderSettings &render_settings);
+
+        json::Document GetMapData(int id, const json::RawJson &map);
+
+        Handbook::Renderer::RenderSettings ReadRenderSettings(json::Dict data);
     } // namespace Views
 } // namespace Handbook
@@ -14,20 +14,33 @@
 
 namespace graph {
 
+    // Общий интерфейс движков маршрутизации: RouteFinder выбирает реализацию при создании
     template<typename Weight>
-    class Router {
+    class RouteEngine {
+    public:
+        struct RouteInfo {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        virtual ~RouteEngine() = default;
+    };
+
+    // Все пары кратчайших путей (Флойд - Уоршелл): O(V^3) времени и O(V^2) памяти на построение,
+    // зато запрос - только восстановление пути. Годится для небольших сетей
+    template<typename Weight>
+    class Router : public RouteEngine<Weight> {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
         explicit Router(const Graph &graph);
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
-        };
+        using RouteInfo = typename RouteEngine<Weight>::RouteInfo;
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
 
     private:
         struct RouteInternalData {
@@ -1,11 +1,202 @@
 #include "serialization.h"
+#include "flat_base.h"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+// С этой версии остановки в расстояниях и маршрутах записаны индексами, а не именами
+static constexpr uint32_t INDEXED_SCHEMA_VERSION = 1;
+// С этой версии настройки отрисовки хранятся готовыми полями, без JSON внутри
+static constexpr uint32_t TYPED_RENDER_SCHEMA_VERSION = 2;
+
+static void SaveColor(const svg::Color &color, protodata::Color *color_proto) {
+    if (const auto *name = std::get_if<std::string>(&color)) {
+        color_proto->set_name(*name);
+    } else if (const auto *rgb = std::get_if<svg::Rgb>(&color)) {
+        color_proto->mutable_rgb()->set_red(rgb->red);
+        color_proto->mutable_rgb()->set_green(rgb->green);
+        color_proto->mutable_rgb()->set_blue(rgb->blue);
+    } else if (const auto *rgba = std::get_if<svg::Rgba>(&color)) {
+        color_proto->mutable_rgba()->set_red(rgba->red);
+        color_proto->mutable_rgba()->set_green(rgba->green);
+        color_proto->mutable_rgba()->set_blue(rgba->blue);
+        color_proto->mutable_rgba()->set_opacity(rgba->opacity);
+    }
+}
+
+static svg::Color LoadColor(const protodata::Color &color_proto) {
+    switch (color_proto.value_case()) {
+        case protodata::Color::kName:
+            return color_proto.name();
+        case protodata::Color::kRgb:
+            return svg::Rgb(color_proto.rgb().red(), color_proto.rgb().green(), color_proto.rgb().blue());
+        case protodata::Color::kRgba:
+            return svg::Rgba(color_proto.rgba().red(), color_proto.rgba().green(), color_proto.rgba().blue(),
+                             color_proto.rgba().opacity());
+        default:
+            return {};
+    }
+}
+
+static void SaveRenderSettings(const Handbook::Renderer::RenderSettings &settings,
+                               protodata::RenderSettings *settings_proto) {
+    settings_proto->set_width(settings.width);
+    settings_proto->set_height(settings.height);
+    settings_proto->set_padding(settings.padding);
+    settings_proto->set_stop_radius(settings.stop_radius);
+    settings_proto->set_line_width(settings.line_width);
+    settings_proto->set_bus_label_font_size(settings.bus_label_font_size);
+    settings_proto->mutable_bus_label_point()->set_x(settings.bus_label_offset.x);
+    settings_proto->mutable_bus_label_point()->set_y(settings.bus_label_offset.y);
+    settings_proto->set_stop_label_font_size(settings.stop_label_font_size);
+    settings_proto->mutable_stop_label_point()->set_x(settings.stop_label_offset.x);
+    settings_proto->mutable_stop_label_point()->set_y(settings.stop_label_offset.y);
+    SaveColor(settings.underlayer_color, settings_proto->mutable_underlayer());
+    settings_proto->set_underlayer_width(settings.underlayer_width);
+    for (const auto &color : settings.color_palette) {
+        SaveColor(color, settings_proto->add_palette());
+    }
+}
+
+static Handbook::Renderer::RenderSettings LoadRenderSettings(const protodata::RenderSettings &settings_proto) {
+    Handbook::Renderer::RenderSettings settings;
+    settings.width = settings_proto.width();
+    settings.height = settings_proto.height();
+    settings.padding = settings_proto.padding();
+    settings.stop_radius = settings_proto.stop_radius();
+    settings.line_width = settings_proto.line_width();
+    settings.bus_label_font_size = static_cast<int>(settings_proto.bus_label_font_size());
+    settings.bus_label_offset = {settings_proto.bus_label_point().x(), settings_proto.bus_label_point().y()};
+    settings.stop_label_font_size = static_cast<int>(settings_proto.stop_label_font_size());
+    settings.stop_label_offset = {settings_proto.stop_label_point().x(), settings_proto.stop_label_point().y()};
+    settings.underlayer_color = LoadColor(settings_proto.underlayer());
+    settings.underlayer_width = settings_proto.underlayer_width();
+    settings.color_palette.reserve(settings_proto.palette_size());
+    for (const auto &color : settings_proto.palette()) {
+        settings.color_palette.push_back(LoadColor(color));
+    }
+    return settings;
+}
+
+// Расстояния и автобусы по индексам остановок: ни разбора строк, ни поиска по имени
+static void LoadIndexedRoutes(const protodata::TransportCatalogue &tc_proto,
+                              const std::vector<Handbook::Data::StopPtr> &stops,
+                              Handbook::Data::TransportCatalogue *catalogue) {
+    const auto &distances = tc_proto.stop_distances();
+    if (distances.size() % 3 != 0) {
+        throw std::invalid_argument("Broken base: stop_distances is not a list of triples");
+    }
+    catalogue->ReserveStopsDistances(static_cast<size_t>(distances.size() / 3));
+    for (int i = 0; i < distances.size(); i += 3) {
+        catalogue->AddStopsDistance(stops.at(distances[i]), stops.at(distances[i + 1]),
+                                    static_cast<int>(distances[i + 2]));
+    }
+    for (const auto &item : tc_proto.buses()) {
+        std::vector<Handbook::Data::StopId> bus_stops;
+        bus_stops.reserve(item.stop_indices_size());
+        for (const uint32_t index : item.stop_indices()) {
+            bus_stops.push_back(stops.at(index)->id);
+        }
+        catalogue->AddBus(item.name(), std::move(bus_stops), item.is_roundtrip());
+    }
+}
+
+static protodata::GraphModel SaveGraphModel(transport::GraphModel model) {
+    return model == transport::GraphModel::StopPairs ? protodata::STOP_PAIRS : protodata::RIDE_VERTICES;
+}
+
+static transport::GraphModel LoadGraphModel(protodata::GraphModel model) {
+    return model == protodata::STOP_PAIRS ? transport::GraphModel::StopPairs : transport::GraphModel::RideVertices;
+}
+
+static void SaveSpending(const transport::TripSpending &spending, protodata::TripSpending *spending_proto) {
+    spending_proto->set_stop_count(spending.stop_count);
+    spending_proto->set_wait_time(spending.wait_time);
+    spending_proto->set_trip_time(spending.trip_time);
+}
+
+static transport::TripSpending LoadSpending(const protodata::TripSpending &spending_proto) {
+    return {spending_proto.stop_count(), spending_proto.wait_time(), spending_proto.trip_time()};
+}
+
+static void SaveHierarchy(const transport::RouteFinder::Hierarchy::Data &data, transport::GraphModel model,
+                          protodata::ContractionHierarchy *hierarchy_proto) {
+    using Hierarchy = transport::RouteFinder::Hierarchy;
+    hierarchy_proto->set_graph_model(SaveGraphModel(model));
+    hierarchy_proto->mutable_ranks()->Reserve(static_cast<int>(data.ranks.size()));
+    for (const size_t rank : data.ranks) {
+        hierarchy_proto->add_ranks(static_cast<uint32_t>(rank));
+    }
+    hierarchy_proto->mutable_edges()->Reserve(static_cast<int>(data.edges.size()));
+    for (const auto &edge : data.edges) {
+        protodata::HierarchyEdge *edge_proto = hierarchy_proto->add_edges();
+        edge_proto->set_from(static_cast<uint32_t>(edge.from));
+        edge_proto->set_to(static_cast<uint32_t>(edge.to));
+        SaveSpending(edge.weight, edge_proto->mutable_weight());
+        edge_proto->set_first(static_cast<uint32_t>(edge.first));
+        edge_proto->set_is_shortcut(edge.second != Hierarchy::NO_EDGE);
+        if (edge.second != Hierarchy::NO_EDGE) {
+            edge_proto->set_second(static_cast<uint32_t>(edge.second));
+        }
+    }
+}
+
+static transport::RouteFinder::Hierarchy::Data LoadHierarchy(const protodata::ContractionHierarchy &hierarchy_proto) {
+    using Hierarchy = transport::RouteFinder::Hierarchy;
+    Hierarchy::Data data;
+    data.ranks.assign(hierarchy_proto.ranks().begin(), hierarchy_proto.ranks().end());
+    data.edges.reserve(hierarchy_proto.edges_size());
+    for (const auto &edge : hierarchy_proto.edges()) {
+        data.edges.push_back({edge.from(), edge.to(), LoadSpending(edge.weight()), edge.first(),
+                              edge.is_shortcut() ? edge.second() : Hierarchy::NO_EDGE});
+    }
+    return data;
+}
+
+static void SaveRoutingGraph(const transport::RouteFinder::Data &data, protodata::RoutingGraph *graph_proto) {
+    graph_proto->set_graph_model(SaveGraphModel(data.model));
+    graph_proto->set_vertex_count(static_cast<uint32_t>(data.vertex_count));
+    graph_proto->mutable_edges()->Reserve(static_cast<int>(data.edges.size()));
+    for (const auto &edge : data.edges) {
+        protodata::RouteEdge *edge_proto = graph_proto->add_edges();
+        edge_proto->set_from(static_cast<uint32_t>(edge.from));
+        edge_proto->set_to(static_cast<uint32_t>(edge.to));
+        edge_proto->set_from_stop(static_cast<uint32_t>(edge.from_stop));
+        edge_proto->set_to_stop(static_cast<uint32_t>(edge.to_stop));
+        edge_proto->set_bus(static_cast<uint32_t>(edge.bus));
+        SaveSpending(edge.spending, edge_proto->mutable_spending());
+        edge_proto->set_kind(static_cast<protodata::RouteEdgeKind>(edge.kind));
+    }
+}
+
+static transport::RouteFinder::Data LoadRoutingGraph(const protodata::RoutingGraph &graph_proto) {
+    transport::RouteFinder::Data data;
+    data.model = LoadGraphModel(graph_proto.graph_model());
+    data.vertex_count = graph_proto.vertex_count();
+    data.edges.reserve(graph_proto.edges_size());
+    for (const auto &edge : graph_proto.edges()) {
+        data.edges.push_back({edge.from(), edge.to(), edge.from_stop(), edge.to_stop(), edge.bus(),
+                              LoadSpending(edge.spending()),
+                              static_cast<transport::RouteFinder::EdgeKind>(edge.kind())});
+    }
+    return data;
+}
 
 Handbook::Control::Serializer::Serializer(std::istream &out, Handbook::Data::TransportCatalogue *tCPtr)
         : out_(out), t_c_ptr_(tCPtr), doc_({}) {
     doc_ = json::Load(out_);
-    ouput_path_ = doc_.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString();
-    render_settings_ = JsonDocToString_(json::Document(doc_.GetRoot().AsDict().at("render_settings").AsDict()));
+    const auto &serialization_settings = doc_.GetRoot().AsDict().at("serialization_settings").AsDict();
+    ouput_path_ = serialization_settings.at("file").AsString();
+    if (const auto format = serialization_settings.find("format"); format != serialization_settings.end()) {
+        if (format->second.AsString() == "flat") {
+            flat_format_ = true;
+        } else if (format->second.AsString() != "protobuf") {
+            throw std::invalid_argument("serialization_settings.format must be \"protobuf\" or \"flat\"");
+        }
+    }
     FillDataBase_();
     Serialize_();
 }
@@ -44,188 +235,291 @@ void Handbook::Control::Serializer::FillDataBase_() {
 }
 
 void Handbook::Control::Serializer::Serialize_() {
+    const Handbook::Renderer::RenderSettings render_settings =
+            Handbook::Views::ReadRenderSettings(doc_.GetRoot().AsDict().at("render_settings").AsDict());
+    const auto &routing_settings = doc_.GetRoot().AsDict().at("routing_settings").AsDict();
+    const int bus_wait_time = routing_settings.at("bus_wait_time").AsInt();
+    const double bus_velocity = routing_settings.at("bus_velocity").AsDouble();
+    // граф и иерархия для маршрутов строятся здесь один раз, process_requests только загружает их
+    transport::RouteFinder route_finder(t_c_ptr_, bus_wait_time, bus_velocity,
+                                        transport::RoutingEngine::ContractionHierarchies);
+    const transport::RouteFinder::Data route_data = route_finder.GetData();
+
+    if (flat_format_) {
+        protodata::RenderSettings render_proto;
+        SaveRenderSettings(render_settings, &render_proto);
+        SaveFlatBase(ouput_path_, {t_c_ptr_, bus_wait_time, bus_velocity, render_proto.SerializeAsString(),
+                                   &route_data});
+        return;
+    }
+
     protodata::TransportCatalogue tc_proto;
+    tc_proto.set_schema_version(TYPED_RENDER_SCHEMA_VERSION);
 
-    for (auto stop : t_c_ptr_->AllStops()) {
-        auto stop_name = stop->name;
+    // остановки дальше ссылаются друг на друга и из автобусов по индексу в tc_proto.stops;
+    // пишем их по порядку StopId, и индекс совпадает с id
+    for (Handbook::Data::StopId id = 0; id < t_c_ptr_->GetStopCount(); ++id) {
+        const auto stop = t_c_ptr_->GetStop(id);
         protodata::Stop *tmp = tc_proto.add_stops();
         tmp->set_name(stop->name);
         tmp->set_lat(stop->coordinates.lat);
         tmp->set_lng(stop->coordinates.lng);
     }
-    auto bayaned_stops = t_c_ptr_->AllBayanedStops();
-    tc_proto.set_separator(bayaned_stops.second);
-    for (const auto&[bayaned, dist] : bayaned_stops.first) {
-        (*tc_proto.mutable_distances_between_stops())[bayaned] = dist;
+    const auto distances = t_c_ptr_->AllStopsDistances();
+    tc_proto.mutable_stop_distances()->Reserve(static_cast<int>(distances.size() * 3));
+    for (const auto &[stops, dist] : distances) {
+        tc_proto.add_stop_distances(stops.first->id);
+        tc_proto.add_stop_distances(stops.second->id);
+        tc_proto.add_stop_distances(static_cast<uint32_t>(dist));
     }
     for (auto bus : t_c_ptr_->AllBuses()) {
         protodata::Bus *tmp = tc_proto.add_buses();
         tmp->set_name(bus->name);
         tmp->set_is_roundtrip(bus->is_roundtrip);
-        for (const auto stop : bus->stops) {
-            tmp->add_stops(stop->name);
+        const auto route = t_c_ptr_->GetRouteStops(bus->id);
+        tmp->mutable_stop_indices()->Reserve(static_cast<int>(route.size()));
+        for (const auto stop : route) {
+            tmp->add_stop_indices(stop);
         }
     }
 
-    protodata::RenderSettings *render_settings_tc_ = new protodata::RenderSettings;
-    /*1*/
-    render_settings_tc_->set_width(doc_.GetRoot().AsDict().at("render_settings").AsDict().at("width").AsDouble());
-    /*2*/
-    render_settings_tc_->set_height(doc_.GetRoot().AsDict().at("render_settings").AsDict().at("height").AsDouble());
-    /*3*/
-    render_settings_tc_->set_padding(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("padding").AsDouble());
-    /*4*/
-    render_settings_tc_->set_stop_radius(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("stop_radius").AsDouble());
-    /*5*/
-    render_settings_tc_->set_line_width(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("line_width").AsDouble());
-    /*6*/
-    render_settings_tc_->set_stop_label_font_size(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("stop_label_font_size").AsInt());
-    { /*7*/
-        for (const auto &item : doc_.GetRoot().AsDict().at("render_settings").AsDict().at(
-                "stop_label_offset").AsArray()) {
-            render_settings_tc_->add_stop_label_offset(item.AsDouble());
+    SaveRenderSettings(render_settings, tc_proto.mutable_render());
+    tc_proto.mutable_routing_settings()->set_wait_time(bus_wait_time);
+    tc_proto.mutable_routing_settings()->set_velocity(bus_velocity);
+    SaveHierarchy(*route_data.hierarchy, route_data.model, tc_proto.mutable_contraction_hierarchy());
+    SaveRoutingGraph(route_data, tc_proto.mutable_routing_graph());
+    std::ofstream ofs(ouput_path_, std::ios_base::out | std::ios_base::binary);
+    tc_proto.SerializeToOstream(&ofs);
+}
+
+Handbook::Control::Deserializer::Deserializer(std::istream &out, Handbook::Data::TransportCatalogue *tCPtr)
+        : t_c_ptr_(tCPtr), doc_({}) {
+    doc_ = json::Load(out);
+    input_path = doc_.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString();
+    if (const auto process_settings = doc_.GetRoot().AsDict().find("process_settings");
+            process_settings != doc_.GetRoot().AsDict().end()) {
+        const int threads = process_settings->second.AsDict().at("threads").AsInt();
+        if (threads < 0) {
+            throw std::invalid_argument("process_settings.threads must not be negative");
         }
+        threads_ = threads > 0 ? static_cast<size_t>(threads) : std::max(1u, std::thread::hardware_concurrency());
+    }
+    LoadBase_();
+    // маршрутизатор нужен только для Route: загружается в фоне, пока отвечаем на остальные запросы
+    const auto &requests = doc_.GetRoot().AsDict().at("stat_requests").AsArray();
+    if (std::any_of(requests.begin(), requests.end(),
+                    [](const json::Node &item) { return item.AsDict().at("type").AsString() == "Route"; })) {
+        route_finder_ = std::async(std::launch::async, [this] { return BuildRouteFinder_(); });
     }
-    /*8*/
-    render_settings_tc_->set_underlayer_color(JsonDocToString_(
-            json::Document(doc_.GetRoot().AsDict().at("render_settings").AsDict().at("underlayer_color"))));
-    /*9*/
-    render_settings_tc_->set_underlayer_width(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("underlayer_width").AsDouble());
+}
 
-    /*10*/
-    render_settings_tc_->set_color_palette(
-            JsonDocToString_(json::Document(doc_.GetRoot().AsDict().at("render_settings").AsDict().at(
-                    "color_palette"))));
+Handbook::Control::Deserializer::Deserializer(const std::string &path, Handbook::Data::TransportCatalogue *tCPtr)
+        : t_c_ptr_(tCPtr), doc_({}), input_path(path) {
+    LoadBase_();
+    route_finder_ = std::async(std::launch::async, [this] { return BuildRouteFinder_(); });
+}
 
-    render_settings_tc_->set_bus_label_font_size(
-            doc_.GetRoot().AsDict().at("render_settings").AsDict().at("bus_label_font_size").AsInt());
-    /*12*/
-    {
-        for (const auto &item : doc_.GetRoot().AsDict().at("render_settings").AsDict().at(
-                "bus_label_offset").AsArray()) {
-            render_settings_tc_->add_bus_label_offset(item.AsDouble());
+void Handbook::Control::Deserializer::LoadBase_() {
+    if (IsFlatBase(input_path)) {
+        LoadFlatBase_();
+        return;
+    }
+    std::ifstream ifs(input_path, std::ios_base::in | std::ios_base::binary);
+    protodata::TransportCatalogue tc_proto;
+    // до справочника ничего не трогаем: в serve битая база не должна подменить рабочую
+    if (!ifs || !tc_proto.ParseFromIstream(&ifs)) {
+        throw std::invalid_argument("Broken base");
+    }
+    // у баз schema_version 0 поля нет, зато всегда есть separator
+    if (tc_proto.schema_version() == 0 && tc_proto.separator().empty()) {
+        throw std::invalid_argument("Broken base: no schema_version");
+    }
+    if (tc_proto.schema_version() > TYPED_RENDER_SCHEMA_VERSION) {
+        throw std::invalid_argument("Unsupported base schema_version " + std::to_string(tc_proto.schema_version()));
+    }
+    if (tc_proto.schema_version() >= TYPED_RENDER_SCHEMA_VERSION) {
+        render_settings_ = LoadRenderSettings(tc_proto.render());
+    } else {
+        json::Array blo;
+        for (double item : tc_proto.render().bus_label_offset()) {
+            blo.push_back(item);
+        }
+        json::Array slo;
+        for (double item : tc_proto.render().stop_label_offset()) {
+            slo.push_back(item);
         }
+        const json::Dict render_settings = json::Dict{
+                {"width",                tc_proto.render().width()},
+                {"height",               tc_proto.render().height()},
+                {"padding",              tc_proto.render().padding()},
+                {"stop_radius",          tc_proto.render().stop_radius()},
+                {"line_width",           tc_proto.render().line_width()},
+                {"stop_label_font_size", static_cast<int>(tc_proto.render().stop_label_font_size())},
+                {"stop_label_offset",    slo},
+                {"underlayer_color",     NodeFromString(tc_proto.render().underlayer_color())},
+                {"underlayer_width",     tc_proto.render().underlayer_width()},
+                {"color_palette",        NodeFromString(tc_proto.render().color_palette())},
+                {"bus_label_font_size",  static_cast<int>(tc_proto.render().bus_label_font_size())},
+                {"bus_label_offset",     blo}
+        };
+        render_settings_ = Handbook::Views::ReadRenderSettings(render_settings);
     }
+    routing_settings_.push_back(tc_proto.routing_settings().wait_time());
+    routing_settings_.push_back(tc_proto.routing_settings().velocity());
+    if (tc_proto.has_routing_graph()) {
+        route_data_ = LoadRoutingGraph(tc_proto.routing_graph());
+        if (tc_proto.has_contraction_hierarchy()) {
+            route_data_->hierarchy = LoadHierarchy(tc_proto.contraction_hierarchy());
+        }
+    } else if (tc_proto.has_contraction_hierarchy()) {
+        hierarchy_ = LoadHierarchy(tc_proto.contraction_hierarchy());
+        graph_model_ = LoadGraphModel(tc_proto.contraction_hierarchy().graph_model());
+    }
+    std::vector<Handbook::Data::StopPtr> stops;
+    stops.reserve(tc_proto.stops_size());
+    for (const auto &item : tc_proto.stops()) {
+        stops.push_back(t_c_ptr_->AddStop(item.name(), {.lat = item.lat(), .lng = item.lng()}));
+    }
+    if (tc_proto.schema_version() >= INDEXED_SCHEMA_VERSION) {
+        LoadIndexedRoutes(tc_proto, stops, t_c_ptr_);
+    } else {
+        std::string separator = tc_proto.separator();
+        for (const auto&[key, value] : tc_proto.distances_between_stops()) {
+            // в баянах твоя сила и мудрость
+            // да и списывать не повадно будет из моего гита)
+            t_c_ptr_->AddStopsDistance(key.substr(0, key.find(separator)),
+                                       key.substr(key.find(separator) + separator.size(), key.size()), value);
+        }
+        for (const auto &item : tc_proto.buses()) {
+            std::vector<std::string> bus_stops(item.stops().begin(), item.stops().end());
+            t_c_ptr_->AddBus(item.name(), bus_stops, item.is_roundtrip());
+        }
+    }
+}
 
+void Handbook::Control::Deserializer::LoadFlatBase_() {
+    flat_base_ = std::make_unique<FlatBase>(input_path);
+    const std::string_view render_bytes = flat_base_->GetRenderSettings();
+    protodata::RenderSettings render_proto;
+    if (!render_proto.ParseFromArray(render_bytes.data(), static_cast<int>(render_bytes.size()))) {
+        throw std::invalid_argument("Broken flat base: render settings");
+    }
+    render_settings_ = LoadRenderSettings(render_proto);
+    routing_settings_.push_back(flat_base_->GetBusWaitTime());
+    routing_settings_.push_back(flat_base_->GetBusVelocity());
+    flat_base_->LoadCatalogue(t_c_ptr_);
+}
 
-    /*9*/
-
-    /*11*/
-
+std::unique_ptr<transport::RouteFinder> Handbook::Control::Deserializer::BuildRouteFinder_() {
+    // граф из плоской базы читается только когда маршрутизатор действительно нужен
+    if (flat_base_) {
+        route_data_ = flat_base_->GetRouteData();
+        // больше из файла ничего не нужно
+        flat_base_.reset();
+    }
+    int busWaitTime = std::get<int>(routing_settings_[0]);
+    double busVelocity = std::get<double>(routing_settings_[1]);
+    std::unique_ptr<transport::RouteFinder> r_f;
+    if (route_data_) {
+        r_f = std::make_unique<transport::RouteFinder>(t_c_ptr_, busWaitTime, busVelocity, std::move(*route_data_));
+    } else if (hierarchy_) {
+        r_f = std::make_unique<transport::RouteFinder>(t_c_ptr_, busWaitTime, busVelocity, std::move(*hierarchy_),
+                                                       graph_model_);
+    } else {
+        r_f = std::make_unique<transport::RouteFinder>(t_c_ptr_, busWaitTime, busVelocity);
+    }
+    route_data_.reset();
+    hierarchy_.reset();
+    return r_f;
+}
 
-    { /*9*/
-        for (const auto &item : doc_.GetRoot().AsDict().at("render_settings").AsDict().at(
-                "bus_label_offset").AsArray()) {
-            render_settings_tc_->add_bus_label_offset(item.AsDouble());
+void Handbook::Control::Deserializer::PrintReport() {
+    using namespace std;
+    const auto &needle = doc_.GetRoot().AsDict().find("stat_requests"s)->second.AsArray();
+    // ответы пишутся в поток по мере готовности, без общего json::Array
+    json::Writer writer(std::cout);
+    writer.StartArray();
+    if (threads_ > 1) {
+        for (const auto &item : needle) {
+            Prepare_(item.AsDict());
+        }
+        WriteAnswersParallel_(writer, needle);
+    } else {
+        for (const auto &item : needle) {
+            Answer(writer, item.AsDict());
         }
     }
-    tc_proto.set_allocated_render(render_settings_tc_);
-    protodata::RoutingSettings *r_s = new protodata::RoutingSettings;
-    r_s->set_wait_time(doc_.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_wait_time").AsInt());
-    r_s->set_velocity(doc_.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_velocity").AsDouble());
-    tc_proto.set_allocated_routing_settings(r_s);
-    std::ofstream ofs(ouput_path_, std::ios_base::out | std::ios_base::binary);
-    tc_proto.SerializeToOstream(&ofs);
+    writer.EndArray();
 }
 
-std::string Handbook::Control::Serializer::JsonDocToString_(json::Document &&doc) {
-    std::stringstream ss;
-    json::Print(doc, ss);
-    return ss.str();
+void Handbook::Control::Deserializer::Answer(json::Writer &writer, const json::Dict &request) {
+    Prepare_(request);
+    WriteAnswer_(writer, request);
 }
 
-Handbook::Control::Deserializer::Deserializer(std::istream &out, Handbook::Data::TransportCatalogue *tCPtr)
-        : out_(out), t_c_ptr_(tCPtr), doc_({}) {
-    doc_ = json::Load(out_);
-    input_path = doc_.GetRoot().AsDict().at("serialization_settings").AsDict().at("file").AsString();
-    std::ifstream ifs(input_path, std::ios_base::in | std::ios_base::binary);
-    protodata::TransportCatalogue tc_proto;
-    tc_proto.ParseFromIstream(&ifs);
-    json::Array blo;
-    for (double item : tc_proto.render().bus_label_offset()) {
-        blo.push_back(item);
-    }
-    json::Array slo;
-    for (double item : tc_proto.render().stop_label_offset()) {
-        slo.push_back(item);
-    }
-    render_settings_ = json::Dict{
-            {"width",                tc_proto.render().width()},
-            {"height",               tc_proto.render().height()},
-            {"padding",              tc_proto.render().padding()},
-            {"stop_radius",          tc_proto.render().stop_radius()},
-            {"line_width",           tc_proto.render().line_width()},
-            {"stop_label_font_size", static_cast<int>(tc_proto.render().stop_label_font_size())},
-            {"stop_label_offset",    slo},
-            {"underlayer_color",     NodeFromString(tc_proto.render().underlayer_color())},
-            {"underlayer_width",     tc_proto.render().underlayer_width()},
-            {"color_palette",        NodeFromString(tc_proto.render().color_palette())},
-            {"bus_label_font_size",  static_cast<int>(tc_proto.render().bus_label_font_size())},
-            {"bus_label_offset",     blo}
-    };
-    routing_settings_.push_back(tc_proto.routing_settings().wait_time());
-    routing_settings_.push_back(tc_proto.routing_settings().velocity());
-    for (const auto &item : tc_proto.stops()) {
-        t_c_ptr_->AddStop(item.name(), {.lat = item.lat(), .lng = item.lng()});
+void Handbook::Control::Deserializer::Prepare() {
+    t_c_ptr_->BuildStopSpatialIndex();
+    if (render_settings_ && !map_) {
+        map_ = Handbook::Views::RenderMap(t_c_ptr_, *render_settings_);
     }
-    std::string separator = tc_proto.separator();
-    for (const auto&[key, value] : tc_proto.distances_between_stops()) {
-        // в баянах твоя сила и мудрость
-        // да и списывать не повадно будет из моего гита)
-        t_c_ptr_->AddStopsDistance(key.substr(0, key.find(separator)),
-                                   key.substr(key.find(separator) + separator.size(), key.size()), value);
+    if (!r_f_) {
+        r_f_ = route_finder_.valid() ? route_finder_.get() : BuildRouteFinder_();
     }
-    for (const auto &item : tc_proto.buses()) {
-        std::vector<std::string> stops(item.stops().begin(), item.stops().end());
-        t_c_ptr_->AddBus(item.name(), stops, item.is_roundtrip());
+}
+
+void Handbook::Control::Deserializer::Prepare_(const json::Dict &request) {
+    using namespace std;
+    const std::string &type = request.at("type"s).AsString();
+    if (render_settings_ && type == "Map"s && !map_) {
+        map_ = Handbook::Views::RenderMap(t_c_ptr_, *render_settings_);
+    } else if (!routing_settings_.empty() && type == "Route"s && !r_f_) {
+        // дожидаемся фоновой загрузки только на первом Route
+        r_f_ = route_finder_.valid() ? route_finder_.get() : BuildRouteFinder_();
     }
 }
 
-void Handbook::Control::Deserializer::PrintReport() {
+void Handbook::Control::Deserializer::WriteAnswer_(json::Writer &writer, const json::Dict &request) const {
     using namespace std;
-    json::Array result;
-    auto needle = doc_.GetRoot().AsDict().find("stat_requests"s)->second.AsArray();
-    //	bool settings = doc_.GetRoot().AsDict().find("render_settings") != doc_.GetRoot().AsDict().end();
-    bool settings = !render_settings_.empty();
-    bool routing_settings = !routing_settings_.empty();
-    int busWaitTime = std::get<int>(routing_settings_[0]);
-    double busVelocity = std::get<double>(routing_settings_[1]);;
-//    if (routing_settings) {
-//        busWaitTime = doc_.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_wait_time").AsInt();
-//        busVelocity = doc_.GetRoot().AsDict().at("routing_settings").AsDict().at("bus_velocity").AsDouble();
-//    }
-    std::unique_ptr<transport::RouteFinder> r_f =
-            std::make_unique<transport::RouteFinder>(t_c_ptr_, busWaitTime, busVelocity);
-    json::Node ren_set;
-    for (const auto &item : needle) {
-        if (settings && item.AsDict().at("type"s).AsString() == "Map"s) {
-
-            result.push_back(std::move(
-                    Handbook::Views::GetData(json::Document(json::Node{json::Dict{
-                                                     {"type"s,            "Map"s},
-                                                     {"id"s,              item.AsDict().at("id"s).AsInt()},
-                                                     {"render_settings"s, json::Node(render_settings_)}}}),
-                                             t_c_ptr_, nullptr)
-                            .GetRoot()));
-        } else if (routing_settings && item.AsDict().at("type").AsString() == "Route") {
-            result.push_back(
-                    std::move(Handbook::Views::GetData(
-                            json::Document(json::Node{json::Dict{{"type"s, "Route"s},
-                                                                 {"id"s,   item.AsDict().at("id"s).AsInt()},
-                                                                 {"from"s, item.AsDict().at("from"s).AsString()},
-                                                                 {"to"s,   item.AsDict().at("to"s).AsString()}}}),
-                            t_c_ptr_, r_f.get())
-                                      .GetRoot()));
-        } else {
-            result.push_back(std::move(Handbook::Views::GetData(json::Document(item), t_c_ptr_, nullptr).GetRoot()));
-        }
-    }
-    json::Print(json::Document(result), std::cout);
+    const std::string &type = request.at("type"s).AsString();
+    if (render_settings_ && type == "Map"s) {
+        Handbook::Views::WriteMapData(writer, request.at("id"s).AsInt(), *map_);
+    } else if (!routing_settings_.empty() && type == "Route"s) {
+        Handbook::Views::WriteData(writer, request, t_c_ptr_, r_f_.get());
+    } else {
+        Handbook::Views::WriteData(writer, request, t_c_ptr_, nullptr);
+    }
+}
+
+void Handbook::Control::Deserializer::WriteAnswersParallel_(json::Writer &writer,
+                                                            const json::Array &requests) const {
+    // пачка ограничивает память под готовые ответы
+    constexpr size_t BATCH_SIZE = 4096;
+    std::vector<std::string> answers;
+    for (size_t begin = 0; begin < requests.size(); begin += BATCH_SIZE) {
+        const size_t count = std::min(BATCH_SIZE, requests.size() - begin);
+        answers.assign(count, {});
+        std::atomic<size_t> next{0};
+        auto work = [&] {
+            std::ostringstream out;
+            for (size_t i = next++; i < count; i = next++) {
+                out.str({});
+                json::Writer answer(out, 1);
+                WriteAnswer_(answer, requests[begin + i].AsDict());
+                answers[i] = out.str();
+            }
+        };
+        std::vector<std::future<void>> workers;
+        for (size_t thread = 1; thread < threads_; ++thread) {
+            workers.push_back(std::async(std::launch::async, work));
+        }
+        work();
+        for (auto &worker : workers) {
+            worker.get();
+        }
+        for (auto &answer : answers) {
+            writer.Value(json::RawJson{std::make_shared<const std::string>(std::move(answer))});
+        }
+    }
 }
 
 json::Dict Handbook::Control::Deserializer::DictFromString(const std::string &str) {
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "domain.h"
+#include "flat_base.h"
 #include "json.h"
 #include "map_renderer.h"
 #include "request_handler.h"
 #include "transport_catalogue.h"
 #include "transport_catalogue.pb.h"
 
+#include <future>
+#include <memory>
+
 namespace Handbook {
     namespace Control {
         class Serializer {
@@ -18,29 +22,69 @@ namespace Handbook {
             Handbook::Data::TransportCatalogue *t_c_ptr_; /// приватное поле, должно быть с подчеркиванием
             json::Document doc_;
             std::string ouput_path_;
-            std::string render_settings_;
+            // serialization_settings.format: "protobuf" (по умолчанию) или "flat"
+            bool flat_format_ = false;
 
             void FillDataBase_();
 
             void Serialize_();
-
-            // вообще надо к такой фигне zlib )))
-            std::string JsonDocToString_(json::Document &&doc);
         };
 
         class Deserializer {
         public:
             Deserializer(std::istream &out, Data::TransportCatalogue *tCPtr);
 
+            // Только база из файла, без stat_requests: для serve. Маршрутизатор сразу строится в фоне
+            Deserializer(const std::string &path, Data::TransportCatalogue *tCPtr);
+
             void PrintReport();
 
+            // Ответ на один запрос; первый Map рисует карту, первый Route дожидается маршрутизатора
+            void Answer(json::Writer &writer, const json::Dict &request);
+
+            // Карта, маршрутизатор и индекс остановок заранее, чтобы первые запросы не ждали
+            void Prepare();
+
         private:
-            std::istream &out_;
             Handbook::Data::TransportCatalogue *t_c_ptr_; /// приватное поле, должно быть с подчеркиванием
             json::Document doc_;
-            json::Dict render_settings_;
+            // настройки отрисовки читаются один раз при загрузке базы
+            std::optional<Handbook::Renderer::RenderSettings> render_settings_;
+            // карта отрисовывается на первом Map и дальше отдаётся готовой
+            std::optional<json::RawJson> map_;
+            // потоков для ответов на stat_requests (process_settings.threads, 0 - по числу ядер);
+            // при одном ответы пишутся в вывод сразу, по одному
+            size_t threads_ = 1;
             std::string input_path;
             std::vector<std::variant<int, double>> routing_settings_;
+            // граф маршрутов и иерархия из базы: RouteFinder загружается без построения
+            std::optional<transport::RouteFinder::Data> route_data_;
+            // базы без графа: только иерархия, граф строится заново; без неё маршруты ищет Дейкстра
+            std::optional<transport::RouteFinder::Hierarchy::Data> hierarchy_;
+            // модель графа, для которой посчитана иерархия
+            transport::GraphModel graph_model_ = transport::GraphModel::RideVertices;
+            std::unique_ptr<transport::RouteFinder> r_f_;
+            // плоская база остаётся отображённой, пока BuildRouteFinder_ не прочитает из неё граф;
+            // если маршрутизатор так и не понадобился - до конца жизни Deserializer
+            std::unique_ptr<FlatBase> flat_base_;
+            // RouteFinder, который строится в фоне с загрузки базы, если в запросах есть Route.
+            // Объявлен последним: при разрушении сначала дожидаемся потока, потом уходят данные
+            std::future<std::unique_ptr<transport::RouteFinder>> route_finder_;
+
+            void LoadBase_();
+
+            void LoadFlatBase_();
+
+            std::unique_ptr<transport::RouteFinder> BuildRouteFinder_();
+
+            void Prepare_(const json::Dict &request);
+
+            // map_ и r_f_ к этому моменту готовы, если они нужны запросу
+            void WriteAnswer_(json::Writer &writer, const json::Dict &request) const;
+
+            // Запросы идут пачками: потоки разбирают их по одному и пишут ответ в ячейку с его номером,
+            // пачка выводится по порядку. Справочник и маршрутизатор только читаются
+            void WriteAnswersParallel_(json::Writer &writer, const json::Array &requests) const;
 
             json::Dict DictFromString(const std::string &str);
 
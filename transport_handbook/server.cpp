@@ -0,0 +1,133 @@
+#include "server.h"
+#include "json_writer.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+Handbook::Control::Server::Server(std::istream &input, std::ostream &output) : input_(input), output_(output) {
+}
+
+void Handbook::Control::Server::Run() {
+    using namespace std;
+    std::string line;
+    while (std::getline(input_, line)) {
+        if (line.find_first_not_of(" \t\r"s) == std::string::npos) {
+            continue;
+        }
+        FinishReload_(false);
+
+        json::Dict request;
+        try {
+            std::istringstream in(line);
+            request = json::Load(in).GetRoot().AsDict();
+        } catch (const std::exception &) {
+            WriteError_(nullptr, "bad request"sv);
+            continue;
+        }
+
+        if (const auto settings = request.find("serialization_settings"s); settings != request.end()) {
+            const json::Node &node = settings->second;
+            if (!node.IsDict() || node.AsDict().count("file"s) == 0 || !node.AsDict().at("file"s).IsString()) {
+                WriteError_(&request, "bad request"sv);
+                continue;
+            }
+            const std::string &path = node.AsDict().at("file"s).AsString();
+            if (base_) {
+                StartReload_(path);
+                continue;
+            }
+            try {
+                base_ = LoadBase_(path);
+                WriteStatus_(path, {});
+            } catch (const std::exception &e) {
+                WriteStatus_(path, e.what());
+            }
+        } else if (!base_) {
+            WriteError_(&request, "no base loaded"sv);
+        } else {
+            Answer_(request);
+        }
+    }
+    FinishReload_(true);
+}
+
+std::unique_ptr<Handbook::Control::Server::Base> Handbook::Control::Server::LoadBase_(const std::string &path) {
+    using namespace std;
+    if (!std::ifstream(path, std::ios_base::in | std::ios_base::binary)) {
+        throw std::runtime_error("can't open base file"s);
+    }
+    auto base = std::make_unique<Base>();
+    base->catalogue = std::make_unique<Data::TransportCatalogue>();
+    base->deserializer = std::make_unique<Deserializer>(path, base->catalogue.get());
+    base->deserializer->Prepare();
+    return base;
+}
+
+void Handbook::Control::Server::StartReload_(const std::string &path) {
+    // вторая подмена подряд: сначала доводим первую, порядок баз сохраняется
+    FinishReload_(true);
+    pending_path_ = path;
+    pending_ = std::async(std::launch::async, [path] { return LoadBase_(path); });
+}
+
+void Handbook::Control::Server::FinishReload_(bool wait) {
+    if (!pending_.valid()) {
+        return;
+    }
+    if (!wait && pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    try {
+        base_ = pending_.get();
+        WriteStatus_(pending_path_, {});
+    } catch (const std::exception &e) {
+        // старая база остаётся
+        WriteStatus_(pending_path_, e.what());
+    }
+}
+
+void Handbook::Control::Server::Answer_(const json::Dict &request) {
+    // ответ собирается целиком: если запрос сломан, в вывод не попадёт его половина
+    std::ostringstream out;
+    try {
+        json::Writer writer(out, json::Writer::Layout::Compact);
+        base_->deserializer->Answer(writer, request);
+    } catch (const std::exception &) {
+        WriteError_(&request, "bad request");
+        return;
+    }
+    WriteLine_(out.str());
+}
+
+void Handbook::Control::Server::WriteStatus_(std::string_view path, std::string_view error) {
+    std::ostringstream out;
+    json::Writer writer(out, json::Writer::Layout::Compact);
+    writer.StartDict().Key("base").Value(path);
+    if (error.empty()) {
+        writer.Key("status").Value("ready");
+    } else {
+        writer.Key("error_message").Value(error);
+    }
+    writer.EndDict();
+    WriteLine_(out.str());
+}
+
+void Handbook::Control::Server::WriteError_(const json::Dict *request, std::string_view error) {
+    std::ostringstream out;
+    json::Writer writer(out, json::Writer::Layout::Compact);
+    writer.StartDict().Key("error_message").Value(error);
+    if (request) {
+        if (const auto id = request->find("id"); id != request->end() && id->second.IsInt()) {
+            writer.Key("request_id").Value(id->second.AsInt());
+        }
+    }
+    writer.EndDict();
+    WriteLine_(out.str());
+}
+
+void Handbook::Control::Server::WriteLine_(const std::string &line) {
+    output_ << line << '\n';
+    output_.flush();
+}
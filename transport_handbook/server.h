@@ -0,0 +1,57 @@
+#pragma once
+
+#include "json.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+
+#include <future>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace Handbook {
+    namespace Control {
+        // Режим serve: база загружается один раз, дальше на вход по строке приходят JSON-объекты (NDJSON),
+        // ответ на каждый сразу выводится одной строкой.
+        // {"serialization_settings": {"file": ...}} загружает базу, а если она уже есть - подменяет:
+        // новая грузится в фоне, и пока она не готова, запросы отвечает старая
+        class Server {
+        public:
+            Server(std::istream &input, std::ostream &output);
+
+            void Run();
+
+        private:
+            // Справочник и всё, что к нему загружено. deserializer ссылается на catalogue,
+            // поэтому объявлен после него и уничтожается первым
+            struct Base {
+                std::unique_ptr<Data::TransportCatalogue> catalogue;
+                std::unique_ptr<Deserializer> deserializer;
+            };
+
+            // база вместе с картой и маршрутизатором: после подмены первые запросы не ждут
+            static std::unique_ptr<Base> LoadBase_(const std::string &path);
+
+            void StartReload_(const std::string &path);
+
+            // подменяет базу, если фоновая загрузка закончилась; wait - дождаться её
+            void FinishReload_(bool wait);
+
+            void Answer_(const json::Dict &request);
+
+            void WriteStatus_(std::string_view path, std::string_view error);
+
+            void WriteError_(const json::Dict *request, std::string_view error);
+
+            void WriteLine_(const std::string &line);
+
+            std::istream &input_;
+            std::ostream &output_;
+            std::unique_ptr<Base> base_;
+            std::string pending_path_;
+            std::future<std::unique_ptr<Base>> pending_;
+        };
+    } // namespace Control
+} // namespace Handbook
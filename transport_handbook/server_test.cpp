@@ -0,0 +1,115 @@
+#include "serialization.h"
+#include "server.h"
+#include "transport_catalogue.h"
+#include "transport_catalogue.pb.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// serve: битая база при подмене отклоняется, запросы дальше отвечает прежняя
+
+using namespace std::literals;
+
+static int failures = 0;
+
+static void Check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: "s << what << '\n';
+        ++failures;
+    }
+}
+
+static void MakeBase(const std::string &path) {
+    std::istringstream input(R"({
+        "serialization_settings": {"file": ")" + path + R"("},
+        "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+        "render_settings": {
+            "width": 600, "height": 400, "padding": 50, "line_width": 14, "stop_radius": 5,
+            "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+            "stop_label_font_size": 18, "stop_label_offset": [7, -3],
+            "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+            "color_palette": ["green", [255, 160, 0], "red"]
+        },
+        "base_requests": [
+            {"type": "Stop", "name": "A", "latitude": 55.6, "longitude": 37.6, "road_distances": {"B": 1000}},
+            {"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.6, "road_distances": {}},
+            {"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false}
+        ]
+    })");
+    Handbook::Data::TransportCatalogue catalogue;
+    Handbook::Control::Serializer serializer(input, &catalogue);
+}
+
+static std::string ReadFile(const std::string &path) {
+    std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+    return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+static void WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream ofs(path, std::ios_base::out | std::ios_base::binary);
+    ofs << content;
+}
+
+static std::string SettingsLine(const std::string &path) {
+    return R"({"serialization_settings": {"file": ")"s + path + R"("}})"s + '\n';
+}
+
+int main() {
+    const std::string good = "server_test_good.db"s;
+    MakeBase(good);
+    const std::string content = ReadFile(good);
+
+    std::vector<std::string> broken;
+    for (const size_t cut : {size_t{1}, size_t{5}}) {
+        broken.push_back("server_test_cut"s + std::to_string(cut) + ".db"s);
+        WriteFile(broken.back(), content.substr(0, content.size() - cut));
+    }
+    broken.push_back("server_test_empty.db"s);
+    WriteFile(broken.back(), ""s);
+    {
+        protodata::TransportCatalogue future_base;
+        future_base.ParseFromString(content);
+        future_base.set_schema_version(100);
+        broken.push_back("server_test_future.db"s);
+        WriteFile(broken.back(), future_base.SerializeAsString());
+    }
+
+    // вторая подмена подряд дожидается первой: к запросу Bus неудачная подмена уже закончена
+    std::string requests = SettingsLine(good);
+    for (const auto &path : broken) {
+        requests += SettingsLine(path) + SettingsLine(path) + R"({"id": 1, "type": "Bus", "name": "1"})"s + '\n';
+    }
+    std::istringstream input(requests);
+    std::ostringstream output;
+    Handbook::Control::Server(input, output).Run();
+
+    std::vector<std::string> lines;
+    std::istringstream answers(output.str());
+    for (std::string line; std::getline(answers, line);) {
+        lines.push_back(line);
+    }
+    Check(lines.size() == 1 + broken.size() * 3, "line count: "s + output.str());
+    Check(!lines.empty() && lines.front() == R"({"base":")"s + good + R"(","status":"ready"})"s, "good base loads");
+    for (const auto &line : lines) {
+        if (line.find("\"base\""s) != std::string::npos && line.find(good) == std::string::npos) {
+            Check(line.find("\"error_message\""s) != std::string::npos, "broken base rejected: "s + line);
+        }
+        if (line.find("\"request_id\""s) != std::string::npos) {
+            Check(line.find("\"route_length\":2000"s) != std::string::npos, "old base answers: "s + line);
+        }
+    }
+
+    std::remove(good.c_str());
+    for (const auto &path : broken) {
+        std::remove(path.c_str());
+    }
+    if (failures == 0) {
+        std::cerr << "server_test OK\n"s;
+    }
+    return failures == 0 ? 0 : 1;
+}
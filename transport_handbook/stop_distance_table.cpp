@@ -0,0 +1,113 @@
+#include "stop_distance_table.h"
+
+#include <algorithm>
+
+void Handbook::Data::StopDistanceTable::Insert(uint32_t from, uint32_t to, int distance)
+{
+	// до двух новых ячеек: сама пара и обратная
+	if ((used_ + 2) * 2 > slots_.size())
+	{
+		Rehash(std::max(MIN_CAPACITY, slots_.size() * 2));
+	}
+
+	Slot& slot = Locate(MakeKey(from, to));
+	if (slot.key != EMPTY_KEY && slot.is_explicit)
+	{
+		return;
+	}
+	if (slot.key == EMPTY_KEY)
+	{
+		slot.key = MakeKey(from, to);
+		++used_;
+	}
+	slot.distance = distance;
+	slot.is_explicit = true;
+	++explicit_count_;
+
+	if (from == to)
+	{
+		return;
+	}
+	Slot& reverse = Locate(MakeKey(to, from));
+	if (reverse.key == EMPTY_KEY)
+	{
+		reverse.key = MakeKey(to, from);
+		reverse.distance = distance;
+		reverse.is_explicit = false;
+		++used_;
+	}
+}
+
+std::optional<int> Handbook::Data::StopDistanceTable::Find(uint32_t from, uint32_t to) const
+{
+	const Slot* slot = FindSlot(MakeKey(from, to));
+	if (slot == nullptr)
+	{
+		return std::nullopt;
+	}
+	return slot->distance;
+}
+
+size_t Handbook::Data::StopDistanceTable::size() const
+{
+	return explicit_count_;
+}
+
+void Handbook::Data::StopDistanceTable::Reserve(size_t pair_count)
+{
+	// явная пара и, как правило, её обратная
+	size_t capacity = std::max(MIN_CAPACITY, slots_.size());
+	while (capacity < pair_count * 4)
+	{
+		capacity *= 2;
+	}
+	if (capacity > slots_.size())
+	{
+		Rehash(capacity);
+	}
+}
+
+Handbook::Data::StopDistanceTable::Slot& Handbook::Data::StopDistanceTable::Locate(uint64_t key)
+{
+	const size_t mask = slots_.size() - 1;
+	for (size_t index = Mix(key) & mask;; index = (index + 1) & mask)
+	{
+		if (slots_[index].key == key || slots_[index].key == EMPTY_KEY)
+		{
+			return slots_[index];
+		}
+	}
+}
+
+const Handbook::Data::StopDistanceTable::Slot* Handbook::Data::StopDistanceTable::FindSlot(uint64_t key) const
+{
+	if (slots_.empty())
+	{
+		return nullptr;
+	}
+	const size_t mask = slots_.size() - 1;
+	for (size_t index = Mix(key) & mask;; index = (index + 1) & mask)
+	{
+		if (slots_[index].key == key)
+		{
+			return &slots_[index];
+		}
+		if (slots_[index].key == EMPTY_KEY)
+		{
+			return nullptr;
+		}
+	}
+}
+
+void Handbook::Data::StopDistanceTable::Rehash(size_t capacity)
+{
+	std::vector<Slot> old_slots(capacity);
+	old_slots.swap(slots_);
+	for (const Slot& slot : old_slots)
+	{
+		if (slot.key != EMPTY_KEY)
+		{
+			Locate(slot.key) = slot;
+		}
+	}
+}
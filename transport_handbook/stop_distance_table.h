@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Handbook
+{
+	namespace Data
+	{
+		// Расстояния между парами остановок (по StopId): открытая адресация с линейным пробированием,
+		// ключ - пара id в одном uint64_t, хеш - финализатор splitmix64.
+		// Обратное направление дописывается при вставке, поэтому поиск - одно пробирование, а не два
+		class StopDistanceTable
+		{
+		  public:
+			// Задаёт расстояние from -> to; повторная вставка той же пары ничего не меняет.
+			// Пока to -> from не задано явно, оно отвечает этим же расстоянием
+			void Insert(uint32_t from, uint32_t to, int distance);
+
+			std::optional<int> Find(uint32_t from, uint32_t to) const;
+
+			// Сколько пар задано явно
+			size_t size() const;
+
+			void Reserve(size_t pair_count);
+
+			// Только явно заданные пары: f(from, to, distance)
+			template <typename F> void ForEach(F f) const
+			{
+				for (const Slot& slot : slots_)
+				{
+					if (slot.key != EMPTY_KEY && slot.is_explicit)
+					{
+						f(static_cast<uint32_t>(slot.key >> 32), static_cast<uint32_t>(slot.key), slot.distance);
+					}
+				}
+			}
+
+		  private:
+			static constexpr uint64_t EMPTY_KEY = ~uint64_t{0};
+			static constexpr size_t MIN_CAPACITY = 16;
+
+			struct Slot
+			{
+				uint64_t key = EMPTY_KEY;
+				int distance = 0;
+				bool is_explicit = false;
+			};
+
+			static uint64_t MakeKey(uint32_t from, uint32_t to)
+			{
+				return static_cast<uint64_t>(from) << 32 | to;
+			}
+
+			static uint64_t Mix(uint64_t key)
+			{
+				key ^= key >> 30;
+				key *= 0xbf58476d1ce4e5b9ULL;
+				key ^= key >> 27;
+				key *= 0x94d049bb133111ebULL;
+				key ^= key >> 31;
+				return key;
+			}
+
+			// Ячейка с ключом key или пустая, куда он встанет
+			Slot& Locate(uint64_t key);
+
+			const Slot* FindSlot(uint64_t key) const;
+
+			// Заполненность не больше половины: короткие цепочки при линейном пробировании
+			void Rehash(size_t capacity);
+
+			std::vector<Slot> slots_;
+			size_t used_ = 0;
+			size_t explicit_count_ = 0;
+		};
+	} // namespace Data
+} // namespace Handbook
@@ -0,0 +1,179 @@
+#include "stop_spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	constexpr double EARTH_RADIUS = 6371000;
+	constexpr double DEGREE = M_PI / 180.0;
+
+	template <typename P> constexpr size_t DIM = std::extent_v<decltype(P::axis)>;
+
+	// квадрат хорды, id
+	using Candidate = std::pair<double, uint32_t>;
+
+	void ToSphere(Handbook::Utilities::Coordinates point, double (&axis)[3])
+	{
+		const double lat = point.lat * DEGREE;
+		const double lng = point.lng * DEGREE;
+		axis[0] = std::cos(lat) * std::cos(lng);
+		axis[1] = std::cos(lat) * std::sin(lng);
+		axis[2] = std::sin(lat);
+	}
+
+	double ChordToDistance(double chord_square)
+	{
+		return 2 * std::asin(std::min(1.0, std::sqrt(chord_square) / 2)) * EARTH_RADIUS;
+	}
+
+	// Ось разбиения чередуется с глубиной
+	template <typename P> void BuildTree(P* begin, P* end, size_t depth)
+	{
+		if (end - begin <= 1)
+		{
+			return;
+		}
+		const size_t axis = depth % DIM<P>;
+		P* mid = begin + (end - begin) / 2;
+		std::nth_element(begin, mid, end, [axis](const P& lhs, const P& rhs) { return lhs.axis[axis] < rhs.axis[axis]; });
+		BuildTree(begin, mid, depth + 1);
+		BuildTree(mid + 1, end, depth + 1);
+	}
+
+	// heap - max-куча из не больше чем count лучших кандидатов
+	template <typename P>
+	void SearchNearest(const P* begin, const P* end, size_t depth, const P& target, size_t count,
+					   std::vector<Candidate>& heap)
+	{
+		if (begin == end)
+		{
+			return;
+		}
+		const size_t axis = depth % DIM<P>;
+		const P* mid = begin + (end - begin) / 2;
+
+		Candidate candidate{0.0, mid->id};
+		for (size_t i = 0; i < DIM<P>; ++i)
+		{
+			const double diff = mid->axis[i] - target.axis[i];
+			candidate.first += diff * diff;
+		}
+		if (heap.size() < count)
+		{
+			heap.push_back(candidate);
+			std::push_heap(heap.begin(), heap.end());
+		}
+		else if (candidate < heap.front())
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			heap.back() = candidate;
+			std::push_heap(heap.begin(), heap.end());
+		}
+
+		const double diff = target.axis[axis] - mid->axis[axis];
+		const bool left_first = diff < 0;
+		SearchNearest(left_first ? begin : mid + 1, left_first ? mid : end, depth + 1, target, count, heap);
+		// по другую сторону плоскости всё дальше, чем diff; равенство - ради порядка по id
+		if (heap.size() < count || diff * diff <= heap.front().first)
+		{
+			SearchNearest(left_first ? mid + 1 : begin, left_first ? end : mid, depth + 1, target, count, heap);
+		}
+	}
+
+	template <typename P>
+	void SearchBox(const P* begin, const P* end, size_t depth, const P& min, const P& max, std::vector<uint32_t>& result)
+	{
+		if (begin == end)
+		{
+			return;
+		}
+		const size_t axis = depth % DIM<P>;
+		const P* mid = begin + (end - begin) / 2;
+
+		bool inside = true;
+		for (size_t i = 0; i < DIM<P>; ++i)
+		{
+			inside = inside && min.axis[i] <= mid->axis[i] && mid->axis[i] <= max.axis[i];
+		}
+		if (inside)
+		{
+			result.push_back(mid->id);
+		}
+
+		if (min.axis[axis] <= mid->axis[axis])
+		{
+			SearchBox(begin, mid, depth + 1, min, max, result);
+		}
+		if (mid->axis[axis] <= max.axis[axis])
+		{
+			SearchBox(mid + 1, end, depth + 1, min, max, result);
+		}
+	}
+} // namespace
+
+Handbook::Data::StopSpatialIndex::StopSpatialIndex(const std::vector<Utilities::Coordinates>& coordinates)
+{
+	sphere_points_.reserve(coordinates.size());
+	plane_points_.reserve(coordinates.size());
+	for (uint32_t id = 0; id < coordinates.size(); ++id)
+	{
+		SpherePoint& sphere_point = sphere_points_.emplace_back();
+		ToSphere(coordinates[id], sphere_point.axis);
+		sphere_point.id = id;
+		plane_points_.push_back({{coordinates[id].lat, coordinates[id].lng}, id});
+	}
+	BuildTree(sphere_points_.data(), sphere_points_.data() + sphere_points_.size(), 0);
+	BuildTree(plane_points_.data(), plane_points_.data() + plane_points_.size(), 0);
+}
+
+std::vector<Handbook::Data::StopSpatialIndex::Neighbour>
+Handbook::Data::StopSpatialIndex::FindNearest(Utilities::Coordinates point, size_t count) const
+{
+	count = std::min(count, sphere_points_.size());
+	if (count == 0)
+	{
+		return {};
+	}
+	SpherePoint target{};
+	ToSphere(point, target.axis);
+	std::vector<Candidate> heap;
+	heap.reserve(count);
+	SearchNearest(sphere_points_.data(), sphere_points_.data() + sphere_points_.size(), 0, target, count, heap);
+	std::sort_heap(heap.begin(), heap.end());
+
+	std::vector<Neighbour> result;
+	result.reserve(heap.size());
+	for (const auto& [chord_square, id] : heap)
+	{
+		result.push_back({id, ChordToDistance(chord_square)});
+	}
+	return result;
+}
+
+std::vector<uint32_t> Handbook::Data::StopSpatialIndex::FindInBox(Utilities::Coordinates min,
+																  Utilities::Coordinates max) const
+{
+	std::vector<uint32_t> result;
+	if (!(min.lat <= max.lat))
+	{
+		return result;
+	}
+	const auto search = [this, &min, &max, &result](double min_lng, double max_lng) {
+		const PlanePoint lower{{min.lat, min_lng}, 0};
+		const PlanePoint upper{{max.lat, max_lng}, 0};
+		SearchBox(plane_points_.data(), plane_points_.data() + plane_points_.size(), 0, lower, upper, result);
+	};
+	if (min.lng <= max.lng)
+	{
+		search(min.lng, max.lng);
+	}
+	else
+	{
+		search(min.lng, 180.0);
+		search(-180.0, max.lng);
+	}
+	return result;
+}
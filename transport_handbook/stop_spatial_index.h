@@ -0,0 +1,51 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Handbook
+{
+	namespace Data
+	{
+		// Статические k-d деревья по координатам остановок (по StopId), без указателей: узел - медиана
+		// своего отрезка массива, левое поддерево до неё, правое после.
+		// Ближайшие ищутся по точкам на единичной сфере: хорда монотонна по расстоянию по поверхности,
+		// поэтому на спуске ни одного тригонометрического вызова. Прямоугольник - по дереву широта/долгота
+		class StopSpatialIndex
+		{
+		  public:
+			struct Neighbour
+			{
+				uint32_t id = 0;
+				// метры по поверхности Земли
+				double distance = 0.0;
+			};
+
+			StopSpatialIndex() = default;
+
+			explicit StopSpatialIndex(const std::vector<Utilities::Coordinates>& coordinates);
+
+			// count ближайших к point, от ближней к дальней; при равном расстоянии - по id
+			std::vector<Neighbour> FindNearest(Utilities::Coordinates point, size_t count) const;
+
+			// Широта и долгота в [min, max] включительно; min.lng > max.lng - прямоугольник через 180-й меридиан.
+			// Порядок id произвольный
+			std::vector<uint32_t> FindInBox(Utilities::Coordinates min, Utilities::Coordinates max) const;
+
+		  private:
+			template <size_t Dim> struct Point
+			{
+				double axis[Dim];
+				uint32_t id;
+			};
+
+			using SpherePoint = Point<3>;
+			using PlanePoint = Point<2>;
+
+			std::vector<SpherePoint> sphere_points_;
+			std::vector<PlanePoint> plane_points_;
+		};
+	} // namespace Data
+} // namespace Handbook
@@ -1,14 +1,7 @@
 #include "transport_catalogue.h"
 
-double Handbook::Data::Bus::GetCoordinateLength() const
-{
-	double length = std::transform_reduce(
-		next(stops.begin()), stops.end(), stops.begin(), 0.0, std::plus<>{}, [](const auto stop1, const auto stop2) {
-			return Handbook::Utilities::ComputeDistance(stop1->coordinates, stop2->coordinates);
-		});
-
-	return is_roundtrip ? length : length * 2;
-}
+#include <algorithm>
+#include <stdexcept>
 
 const Handbook::Data::Stop* Handbook::Data::TransportCatalogue::FindStop(std::string_view name) const
 {
@@ -23,44 +16,146 @@ const Handbook::Data::Stop* Handbook::Data::TransportCatalogue::FindStop(std::st
 	}
 }
 
-void Handbook::Data::TransportCatalogue::AddStop(std::string_view name, Handbook::Utilities::Coordinates coordinates)
+Handbook::Data::StopPtr Handbook::Data::TransportCatalogue::AddStop(std::string_view name,
+																	 Handbook::Utilities::Coordinates coordinates)
 {
-	const auto& stop = stops_.emplace_back(Stop{std::string(name), coordinates});
+	const auto id = static_cast<StopId>(stops_.size());
+	const auto& stop = stops_.emplace_back(Stop{std::string(name), coordinates, id});
 	stops_by_name_.insert({stop.name, &stop});
+	stop_ptrs_.push_back(&stop);
+	stop_coordinates_.push_back(coordinates);
+	buses_by_stop_ready_ = false;
+	stop_index_ready_ = false;
+	return &stop;
+}
+
+Handbook::Data::StopPtr Handbook::Data::TransportCatalogue::GetStop(StopId id) const
+{
+	return stop_ptrs_[id];
+}
+
+size_t Handbook::Data::TransportCatalogue::GetStopCount() const
+{
+	return stop_ptrs_.size();
+}
+
+const Handbook::Utilities::Coordinates& Handbook::Data::TransportCatalogue::GetStopCoordinates(StopId id) const
+{
+	return stop_coordinates_[id];
+}
+
+std::vector<Handbook::Data::StopSpatialIndex::Neighbour>
+Handbook::Data::TransportCatalogue::FindNearestStops(Utilities::Coordinates point, size_t count) const
+{
+	BuildStopSpatialIndex();
+	return stop_index_.FindNearest(point, count);
+}
+
+std::vector<Handbook::Data::StopId> Handbook::Data::TransportCatalogue::FindStopsInBox(Utilities::Coordinates min,
+																					   Utilities::Coordinates max) const
+{
+	BuildStopSpatialIndex();
+	std::vector<StopId> stops = stop_index_.FindInBox(min, max);
+	std::sort(stops.begin(), stops.end());
+	return stops;
+}
+
+void Handbook::Data::TransportCatalogue::BuildStopSpatialIndex() const
+{
+	if (stop_index_ready_.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	std::lock_guard guard(stop_index_mutex_);
+	if (stop_index_ready_.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	stop_index_ = StopSpatialIndex(stop_coordinates_);
+	stop_index_ready_.store(true, std::memory_order_release);
 }
 
-const std::unordered_set<Handbook::Data::BusPtr>* Handbook::Data::TransportCatalogue::GetBusesOnStop(
-	const Handbook::Data::Stop* stop) const
+Handbook::Data::BusIdRange Handbook::Data::TransportCatalogue::GetBusesOnStop(StopId stop) const
 {
-	const auto needle = buses_by_stop_.find(stop);
+	if (!buses_by_stop_ready_.load(std::memory_order_acquire))
+	{
+		BuildBusesByStop();
+	}
+	return {buses_by_stop_.begin() + buses_by_stop_offsets_[stop],
+			buses_by_stop_.begin() + buses_by_stop_offsets_[stop + 1]};
+}
 
-	if (needle == buses_by_stop_.end())
+void Handbook::Data::TransportCatalogue::BuildBusesByStop() const
+{
+	std::lock_guard guard(buses_by_stop_mutex_);
+	if (buses_by_stop_ready_.load(std::memory_order_relaxed))
 	{
-		static const std::unordered_set<BusPtr> empty_set;
-		return &empty_set;
+		return;
 	}
 
-	return &needle->second;
+	// подсчёт, префиксные суммы, раскладка; last_bus отсекает повторный заход автобуса на остановку
+	constexpr BusId NO_BUS = static_cast<BusId>(-1);
+	std::vector<BusId> last_bus(stop_ptrs_.size(), NO_BUS);
+	buses_by_stop_offsets_.assign(stop_ptrs_.size() + 1, 0);
+	for (BusId bus = 0; bus < bus_ptrs_.size(); ++bus)
+	{
+		for (const StopId stop : GetRouteStops(bus))
+		{
+			if (last_bus[stop] != bus)
+			{
+				last_bus[stop] = bus;
+				++buses_by_stop_offsets_[stop + 1];
+			}
+		}
+	}
+	for (size_t stop = 0; stop < stop_ptrs_.size(); ++stop)
+	{
+		buses_by_stop_offsets_[stop + 1] += buses_by_stop_offsets_[stop];
+	}
+	buses_by_stop_.resize(buses_by_stop_offsets_.back());
+	std::vector<uint32_t> next(buses_by_stop_offsets_.begin(), buses_by_stop_offsets_.end() - 1);
+	std::fill(last_bus.begin(), last_bus.end(), NO_BUS);
+	for (BusId bus = 0; bus < bus_ptrs_.size(); ++bus)
+	{
+		for (const StopId stop : GetRouteStops(bus))
+		{
+			if (last_bus[stop] != bus)
+			{
+				last_bus[stop] = bus;
+				buses_by_stop_[next[stop]++] = bus;
+			}
+		}
+	}
+	buses_by_stop_ready_.store(true, std::memory_order_release);
 }
 
 void Handbook::Data::TransportCatalogue::AddStopsDistance(std::string_view from_stop, std::string_view to_stop,
 														  int distance)
 {
-	auto p = std::make_pair(FindStop(from_stop), FindStop(to_stop));
-	auto res = std::make_pair(p, distance);
+	AddStopsDistance(FindStop(from_stop), FindStop(to_stop), distance);
+}
 
-	stop_distances_.insert(res);
+void Handbook::Data::TransportCatalogue::AddStopsDistance(const Handbook::Data::Stop* from_stop,
+														  const Handbook::Data::Stop* to_stop, int distance)
+{
+	stop_distances_.Insert(from_stop->id, to_stop->id, distance);
+	bus_stats_ready_ = false;
+}
+
+void Handbook::Data::TransportCatalogue::ReserveStopsDistances(size_t count)
+{
+	stop_distances_.Reserve(count);
 }
 
 std::unordered_set<Handbook::Data::BusPtr> Handbook::Data::TransportCatalogue::GetBusesWithStops() const
 {
 	std::unordered_set<BusPtr> buses;
 
-	for (const auto& bus : buses_)
+	for (BusId bus = 0; bus < bus_ptrs_.size(); ++bus)
 	{
-		if (!bus.stops.empty())
+		if (route_offsets_[bus] != route_offsets_[bus + 1])
 		{
-			buses.insert(&bus);
+			buses.insert(bus_ptrs_[bus]);
 		}
 	}
 
@@ -70,60 +165,144 @@ std::unordered_set<Handbook::Data::BusPtr> Handbook::Data::TransportCatalogue::G
 int Handbook::Data::TransportCatalogue::FindStopsDistance(const Handbook::Data::Stop* from_stop_ptr,
 														  const Handbook::Data::Stop* to_stop_ptr) const
 {
-	auto distance_it = stop_distances_.find({from_stop_ptr, to_stop_ptr});
-
-	if (distance_it == stop_distances_.end())
-	{
-		distance_it = stop_distances_.find({to_stop_ptr, from_stop_ptr});
-	}
+	return FindStopsDistance(from_stop_ptr->id, to_stop_ptr->id);
+}
 
-	return distance_it->second;
+int Handbook::Data::TransportCatalogue::FindStopsDistance(StopId from_stop, StopId to_stop) const
+{
+	return stop_distances_.Find(from_stop, to_stop).value();
 }
 
 void Handbook::Data::TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string>& bus_stops,
 												bool is_roundtrip)
 {
-	std::vector<const Stop*> stops;
+	std::vector<StopId> stops;
 	stops.reserve(bus_stops.size());
 
-	auto& bus = buses_.emplace_back(Bus{std::string(name), is_roundtrip, stops});
-
 	for (const auto& stop_name : bus_stops)
 	{
-		const auto* stop_ptr = FindStop(stop_name);
-		bus.stops.push_back(stop_ptr);
-		buses_by_stop_[stop_ptr].emplace(&bus);
+		stops.push_back(FindStop(stop_name)->id);
 	}
 
+	AddBus(name, std::move(stops), is_roundtrip);
+}
+
+void Handbook::Data::TransportCatalogue::AddBus(std::string_view name, std::vector<StopId> bus_stops,
+												bool is_roundtrip)
+{
+	const auto id = static_cast<BusId>(buses_.size());
+	auto& bus = buses_.emplace_back(Bus{std::string(name), is_roundtrip, id});
+
+	bus_ptrs_.push_back(&bus);
+	route_stops_.insert(route_stops_.end(), bus_stops.begin(), bus_stops.end());
+	route_offsets_.push_back(static_cast<uint32_t>(route_stops_.size()));
+	buses_by_stop_ready_ = false;
+	bus_stats_ready_ = false;
+
 	buses_by_name_.insert({bus.name, &bus});
 }
 
-Handbook::Data::BusStat Handbook::Data::TransportCatalogue::GetBusStat(const Handbook::Data::Bus* bus) const
+Handbook::Data::BusPtr Handbook::Data::TransportCatalogue::GetBus(BusId id) const
 {
-	std::vector<const Stop*> stop_ptrs = {bus->stops.begin(), bus->stops.end()};
+	return bus_ptrs_[id];
+}
 
-	std::unordered_set<const Stop*> unique_stop_ptrs;
-	unique_stop_ptrs.reserve(stop_ptrs.size());
+size_t Handbook::Data::TransportCatalogue::GetBusCount() const
+{
+	return bus_ptrs_.size();
+}
 
-	for_each(stop_ptrs.begin(), stop_ptrs.end(), [&unique_stop_ptrs](const auto stop) {
-		if (!unique_stop_ptrs.count(stop))
-		{
-			unique_stop_ptrs.insert(stop);
-		}
-	});
+Handbook::Data::StopIdRange Handbook::Data::TransportCatalogue::GetRouteStops(BusId bus) const
+{
+	return {route_stops_.begin() + route_offsets_[bus], route_stops_.begin() + route_offsets_[bus + 1]};
+}
+
+double Handbook::Data::TransportCatalogue::ComputeGeoLength(BusId bus) const
+{
+	const auto stops = GetRouteStops(bus);
+	double length = std::transform_reduce(
+		next(stops.begin()), stops.end(), stops.begin(), 0.0, std::plus<>{}, [this](const auto stop1, const auto stop2) {
+			return Handbook::Utilities::ComputeDistance(stop_coordinates_[stop1], stop_coordinates_[stop2]);
+		});
+
+	return bus_ptrs_[bus]->is_roundtrip ? length : length * 2;
+}
+
+const Handbook::Data::BusStat& Handbook::Data::TransportCatalogue::GetBusStat(const Handbook::Data::Bus* bus) const
+{
+	return GetBusStat(bus->id);
+}
+
+const Handbook::Data::BusStat& Handbook::Data::TransportCatalogue::GetBusStat(BusId bus) const
+{
+	if (!bus_stats_ready_.load(std::memory_order_acquire))
+	{
+		BuildBusStats();
+	}
+	return bus_stats_[bus];
+}
+
+void Handbook::Data::TransportCatalogue::LoadBusStats(std::vector<BusStat> stats)
+{
+	if (stats.size() != bus_ptrs_.size())
+	{
+		throw std::invalid_argument("Bus stats count differs from bus count");
+	}
+	std::lock_guard guard(bus_stats_mutex_);
+	bus_stats_ = std::move(stats);
+	bus_stats_ready_.store(true, std::memory_order_release);
+}
+
+void Handbook::Data::TransportCatalogue::BuildBusStats() const
+{
+	std::lock_guard guard(bus_stats_mutex_);
+	if (bus_stats_ready_.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	std::vector<BusId> last_seen(stop_ptrs_.size(), 0);
+	bus_stats_.clear();
+	bus_stats_.reserve(bus_ptrs_.size());
+	for (BusId bus = 0; bus < bus_ptrs_.size(); ++bus)
+	{
+		bus_stats_.push_back(ComputeBusStat(bus, last_seen));
+	}
+	bus_stats_ready_.store(true, std::memory_order_release);
+}
+
+Handbook::Data::BusStat Handbook::Data::TransportCatalogue::ComputeBusStat(BusId bus,
+																		   std::vector<BusId>& last_seen) const
+{
+	const auto stops = GetRouteStops(bus);
+	const bool is_roundtrip = bus_ptrs_[bus]->is_roundtrip;
 
-	if (!bus->is_roundtrip)
+	int unique_stops = 0;
+	for (const StopId stop : stops)
 	{
-		stop_ptrs.insert(stop_ptrs.end(), next(bus->stops.rbegin()), bus->stops.rend());
+		if (last_seen[stop] != bus + 1)
+		{
+			last_seen[stop] = bus + 1;
+			++unique_stops;
+		}
 	}
 
 	double route_length = transform_reduce(
-		next(stop_ptrs.begin()), stop_ptrs.end(), stop_ptrs.begin(), 0.0, std::plus<>{},
+		next(stops.begin()), stops.end(), stops.begin(), 0.0, std::plus<>{},
 		[this](const auto stop_to, const auto stop_from) { return FindStopsDistance(stop_from, stop_to); });
+	if (!is_roundtrip)
+	{
+		route_length += transform_reduce(
+			next(stops.begin()), stops.end(), stops.begin(), 0.0, std::plus<>{},
+			[this](const auto stop_to, const auto stop_from) { return FindStopsDistance(stop_to, stop_from); });
+	}
+
+	const int route_size = static_cast<int>(stops.size());
+	const int stops_in_route = is_roundtrip || route_size == 0 ? route_size : route_size * 2 - 1;
 
-	double curvature = route_length / bus->GetCoordinateLength();
+	double curvature = route_length / ComputeGeoLength(bus);
 
-	return {static_cast<int>(stop_ptrs.size()), static_cast<int>(unique_stop_ptrs.size()), route_length, curvature};
+	return {stops_in_route, unique_stops, route_length, curvature};
 }
 
 const Handbook::Data::Bus* Handbook::Data::TransportCatalogue::FindBus(std::string_view name) const
@@ -152,12 +331,13 @@ std::vector<Handbook::Data::StopPtr> Handbook::Data::TransportCatalogue::AllStop
 	return result;
 }
 
-std::pair<std::unordered_map<std::string, int>, std::string> Handbook::Data::TransportCatalogue::AllBayanedStops()
+std::vector<std::pair<Handbook::Data::PairPtrs<Handbook::Data::Stop>, int>> Handbook::Data::TransportCatalogue::
+	AllStopsDistances() const
 {
-	std::unordered_map<std::string, int> result;
-	for (auto& [pair, dist] : stop_distances_)
-	{
-		result[pair.first->name + bayan + pair.second->name] = dist;
-	}
-	return {result, bayan};
+	std::vector<std::pair<PairPtrs<Stop>, int>> result;
+	result.reserve(stop_distances_.size());
+	stop_distances_.ForEach([this, &result](StopId from, StopId to, int dist) {
+		result.push_back({{stop_ptrs_[from], stop_ptrs_[to]}, dist});
+	});
+	return result;
 }
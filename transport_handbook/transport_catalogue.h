@@ -1,8 +1,14 @@
 #pragma once
 
 #include "geo.h"
+#include "ranges.h"
+#include "stop_distance_table.h"
+#include "stop_spatial_index.h"
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <deque>
+#include <mutex>
 #include <numeric>
 #include <set>
 #include <string>
@@ -16,32 +22,28 @@ namespace Handbook
 	{
 		template <typename T> using PairPtrs = std::pair<const T*, const T*>;
 
-		template <typename T> struct PairPtrHasher
-		{
-			uint64_t operator()(const PairPtrs<T>& stops_ptr) const
-			{
-				size_t ptrValue1 = reinterpret_cast<size_t>(stops_ptr.first);
-				size_t ptrValue2 = reinterpret_cast<size_t>(stops_ptr.second);
-				double res_hash = ptrValue1 + ptrValue2 * 47;
-				return static_cast<uint64_t>(std::sqrt(res_hash));
-			}
-		};
+		// Плотные номера в порядке добавления: индексы столбцов справочника
+		using StopId = uint32_t;
+		using BusId = uint32_t;
+
+		using StopIdRange = ranges::Range<std::vector<StopId>::const_iterator>;
+		using BusIdRange = ranges::Range<std::vector<BusId>::const_iterator>;
 
 		struct Stop
 		{
 			std::string name;
 			Utilities::Coordinates coordinates;
+			StopId id = 0;
 		};
 
 		using StopPtr = const Stop*;
 
+		// Остановки маршрута - в TransportCatalogue::GetRouteStops(id)
 		struct Bus
 		{
 			std::string name;
 			bool is_roundtrip = false;
-			std::vector<StopPtr> stops;
-
-			double GetCoordinateLength() const;
+			BusId id = 0;
 		};
 
 		using BusPtr = const Bus*;
@@ -57,41 +59,115 @@ namespace Handbook
 		class TransportCatalogue
 		{
 		  public:
-			void AddStop(std::string_view name, Utilities::Coordinates coordinates);
+			StopPtr AddStop(std::string_view name, Utilities::Coordinates coordinates);
 
 			StopPtr FindStop(std::string_view name) const;
 
-			const std::unordered_set<BusPtr>* GetBusesOnStop(StopPtr stop) const;
+			StopPtr GetStop(StopId id) const;
+
+			size_t GetStopCount() const;
+
+			const Utilities::Coordinates& GetStopCoordinates(StopId id) const;
+
+			// count ближайших к point остановок, от ближней к дальней, с расстоянием в метрах
+			std::vector<StopSpatialIndex::Neighbour> FindNearestStops(Utilities::Coordinates point, size_t count) const;
+
+			// Остановки в прямоугольнике широт/долгот (см. StopSpatialIndex::FindInBox), по возрастанию StopId
+			std::vector<StopId> FindStopsInBox(Utilities::Coordinates min, Utilities::Coordinates max) const;
+
+			// Индекс по координатам строится при первом геопоиске после AddStop; так - заранее
+			void BuildStopSpatialIndex() const;
+
+			// Автобусы через остановку, по возрастанию BusId, без повторов
+			BusIdRange GetBusesOnStop(StopId stop) const;
 
 			std::unordered_set<BusPtr> GetBusesWithStops() const;
 
 			void AddStopsDistance(std::string_view from_stop, std::string_view to_stop, int distance);
 
+			// Для загрузки из базы: остановки уже известны, поиск по имени не нужен
+			void AddStopsDistance(StopPtr from_stop, StopPtr to_stop, int distance);
+
+			// Место под count расстояний, когда их число известно заранее (загрузка базы)
+			void ReserveStopsDistances(size_t count);
+
 			int FindStopsDistance(StopPtr from_stop_ptr, StopPtr to_stop_ptr) const;
 
+			// Расстояние from -> to, а если его не задали - to -> from
+			int FindStopsDistance(StopId from_stop, StopId to_stop) const;
+
 			void AddBus(std::string_view name, const std::vector<std::string>& bus_stops, bool is_roundtrip);
 
+			void AddBus(std::string_view name, std::vector<StopId> bus_stops, bool is_roundtrip);
+
 			BusPtr FindBus(std::string_view name) const; /// желательно поменять тип результата на BusPtr
 
-			BusStat GetBusStat(const Bus* bus) const;
+			BusPtr GetBus(BusId id) const;
+
+			size_t GetBusCount() const;
+
+			// Остановки маршрута в порядке следования (у некольцевого - только в одну сторону)
+			StopIdRange GetRouteStops(BusId bus) const;
+
+			// Статистика считается один раз на все автобусы при первом запросе после изменения справочника
+			const BusStat& GetBusStat(const Bus* bus) const;
+
+			const BusStat& GetBusStat(BusId bus) const;
+
+			// Готовая статистика из базы, по BusId для всех автобусов; до следующего изменения справочника
+			void LoadBusStats(std::vector<BusStat> stats);
 
 			std::vector<BusPtr> AllBuses();
 
 			std::vector<StopPtr> AllStops();
 
-			std::pair<std::unordered_map<std::string, int>, std::string> AllBayanedStops();
+			std::vector<std::pair<PairPtrs<Stop>, int>> AllStopsDistances() const;
 
 		  private:
+			// Длина маршрута по прямой между остановками, туда и обратно для некольцевого
+			double ComputeGeoLength(BusId bus) const;
+
+			void BuildBusesByStop() const;
+
+			// last_seen - отметки StopId для подсчёта уникальных остановок, bus + 1 означает "уже видели"
+			BusStat ComputeBusStat(BusId bus, std::vector<BusId>& last_seen) const;
+
+			void BuildBusStats() const;
+
+			// Stop и Bus не переезжают: на них указывают StopPtr/BusPtr и ключи индексов по имени
 			std::deque<Bus> buses_;
 			std::deque<Stop> stops_;
 
+			// Столбцы по StopId
+			std::vector<StopPtr> stop_ptrs_;
+			std::vector<Utilities::Coordinates> stop_coordinates_;
+
+			// Столбцы по BusId; остановки всех маршрутов подряд в одном буфере:
+			// у автобуса id это route_stops_[route_offsets_[id] .. route_offsets_[id + 1])
+			std::vector<BusPtr> bus_ptrs_;
+			std::vector<uint32_t> route_offsets_{0};
+			std::vector<StopId> route_stops_;
+
 			std::unordered_map<std::string_view, BusPtr> buses_by_name_;
 			std::unordered_map<std::string_view, StopPtr> stops_by_name_;
-			std::unordered_map<StopPtr, std::unordered_set<BusPtr>> buses_by_stop_;
-			std::unordered_map<PairPtrs<Stop>, int, PairPtrHasher<Stop>> stop_distances_;
-			const std::string bayan = "[:|||:]"; /// оставлю здесь, так удобнее менять сепараторы...
-/// не соглашусь с аргументом, класс долже бать споректирован, как другим удобно использовать, а это поле получается бессмысленным
-/// если предполагается менять сепараторы, то должно быть для этого api
+			StopDistanceTable stop_distances_;
+
+			// CSR автобусов по остановкам: строится при первом запросе после AddBus.
+			// Справочник меняется только при загрузке, читать его можно из нескольких потоков
+			mutable std::mutex buses_by_stop_mutex_;
+			mutable std::atomic<bool> buses_by_stop_ready_{false};
+			mutable std::vector<uint32_t> buses_by_stop_offsets_;
+			mutable std::vector<BusId> buses_by_stop_;
+
+			// BusStat по BusId: так же лениво, сбрасывается в AddBus и AddStopsDistance
+			mutable std::mutex bus_stats_mutex_;
+			mutable std::atomic<bool> bus_stats_ready_{false};
+			mutable std::vector<BusStat> bus_stats_;
+
+			// Индекс по координатам: так же лениво, сбрасывается в AddStop
+			mutable std::mutex stop_index_mutex_;
+			mutable std::atomic<bool> stop_index_ready_{false};
+			mutable StopSpatialIndex stop_index_;
 		};
 	} // namespace Data
 } // namespace Handbook
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "transport_router.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 namespace transport
 {
@@ -30,17 +32,19 @@ namespace transport
 	}
 
 	DistanceFinder::DistanceFinder(Handbook::Data::TransportCatalogue* catalogue, Handbook::Data::BusPtr route)
-		: direct_distances_(route->stops.size()), reverse_distances_(route->stops.size())
+		: direct_distances_(catalogue->GetRouteStops(route->id).size()),
+		  reverse_distances_(direct_distances_.size())
 	{
+		const auto stops = catalogue->GetRouteStops(route->id);
 		int directDistanceSum = 0;
 		int reverseDistanceSum = 0;
 		direct_distances_[0] = directDistanceSum;
 		reverse_distances_[0] = reverseDistanceSum;
-		for (size_t i = 1; i < route->stops.size(); ++i)
+		for (size_t i = 1; i < stops.size(); ++i)
 		{
-			directDistanceSum += catalogue->FindStopsDistance(route->stops[i - 1], route->stops[i]);
+			directDistanceSum += catalogue->FindStopsDistance(stops[i - 1], stops[i]);
 			direct_distances_[i] = directDistanceSum;
-			reverseDistanceSum += catalogue->FindStopsDistance(route->stops[i], route->stops[i - 1]);
+			reverseDistanceSum += catalogue->FindStopsDistance(stops[i], stops[i - 1]);
 			reverse_distances_[i] = reverseDistanceSum;
 		}
 	}
@@ -57,28 +61,155 @@ namespace transport
 		}
 	}
 
-	RouteFinder::RouteFinder(Handbook::Data::TransportCatalogue* catalogue, int bus_wait_time, double bus_velocity)
-		: catalogue_(catalogue), bus_wait_time_(bus_wait_time * 60), bus_velocity_(bus_velocity / 3.6)
+	RouteFinder::RouteFinder(Handbook::Data::TransportCatalogue* catalogue, int bus_wait_time, double bus_velocity,
+							 RoutingEngine engine, GraphModel model)
+		: catalogue_(catalogue), model_(model), bus_wait_time_(bus_wait_time * 60), bus_velocity_(bus_velocity / 3.6)
 	{
+		BuildGraph();
+		switch (engine)
+		{
+		case RoutingEngine::AllPairs:
+			router_ = std::make_unique<graph::Router<GraphWeight>>(*graph_);
+			break;
+		case RoutingEngine::Dijkstra:
+			router_ = std::make_unique<graph::DijkstraRouter<GraphWeight>>(*graph_);
+			break;
+		case RoutingEngine::ContractionHierarchies:
+		{
+			auto hierarchy = std::make_unique<Hierarchy>(*graph_);
+			hierarchy_ = hierarchy.get();
+			router_ = std::move(hierarchy);
+			break;
+		}
+		}
+	}
 
-		// Все остановки будут вершинами графа. Добавим их в словарь для быстрого поиска вершины по названию.
-		auto allStops = catalogue_->AllStops();
+	RouteFinder::RouteFinder(Handbook::Data::TransportCatalogue* catalogue, int bus_wait_time, double bus_velocity,
+							 Hierarchy::Data hierarchy, GraphModel model)
+		: catalogue_(catalogue), model_(model), bus_wait_time_(bus_wait_time * 60), bus_velocity_(bus_velocity / 3.6)
+	{
+		BuildGraph();
+		auto engine = std::make_unique<Hierarchy>(*graph_, std::move(hierarchy));
+		hierarchy_ = engine.get();
+		router_ = std::move(engine);
+	}
+
+	RouteFinder::RouteFinder(Handbook::Data::TransportCatalogue* catalogue, int bus_wait_time, double bus_velocity,
+							 Data data)
+		: catalogue_(catalogue), model_(data.model), bus_wait_time_(bus_wait_time * 60),
+		  bus_velocity_(bus_velocity / 3.6)
+	{
+		IndexCatalogue();
+		LoadGraph(data);
+		if (data.hierarchy)
+		{
+			auto engine = std::make_unique<Hierarchy>(*graph_, std::move(*data.hierarchy));
+			hierarchy_ = engine.get();
+			router_ = std::move(engine);
+		}
+		else
+		{
+			router_ = std::make_unique<graph::DijkstraRouter<GraphWeight>>(*graph_);
+		}
+	}
 
-		// Создаём сам граф с нужным количеством вершин
-		graph_ = std::make_unique<NavigationGraph>(allStops.size());
+	const RouteFinder::Hierarchy* RouteFinder::GetHierarchy() const
+	{
+		return hierarchy_;
+	}
 
-		// Добавляем вершины
+	GraphModel RouteFinder::GetGraphModel() const
+	{
+		return model_;
+	}
+
+	RouteFinder::Data RouteFinder::GetData() const
+	{
+		std::vector<size_t> busIndices(catalogue_->GetBusCount());
+		for (size_t i = 0; i < buses_.size(); ++i)
+		{
+			busIndices[buses_[i]->id] = i;
+		}
+
+		Data data;
+		data.model = model_;
+		data.vertex_count = graph_->GetVertexCount();
+		data.edges.reserve(graph_edges_.size());
+		for (graph::EdgeId id = 0; id < graph_edges_.size(); ++id)
+		{
+			const auto& edge = graph_->GetEdge(id);
+			const TripItem& item = graph_edges_[id];
+			data.edges.push_back({edge.from, edge.to, stop_vertices_[item.from->id], stop_vertices_[item.to->id],
+								  busIndices[item.bus->id], item.spending,
+								  edge_kinds_[id]});
+		}
+		if (hierarchy_)
+		{
+			data.hierarchy = hierarchy_->GetData();
+		}
+		return data;
+	}
+
+	void RouteFinder::LoadGraph(const Data& data)
+	{
+		using namespace std;
+		if (data.vertex_count < stops_.size())
+		{
+			throw std::invalid_argument("Routing graph does not match the catalogue: vertex count"s);
+		}
+		graph_ = std::make_unique<NavigationGraph>(data.vertex_count);
+		graph_edges_.reserve(data.edges.size());
+		edge_kinds_.reserve(data.edges.size());
+		for (const EdgeData& edge : data.edges)
+		{
+			if (edge.from >= data.vertex_count || edge.to >= data.vertex_count || edge.from_stop >= stops_.size() ||
+				edge.to_stop >= stops_.size() || edge.bus >= buses_.size())
+			{
+				throw std::invalid_argument("Routing graph does not match the catalogue: edge"s);
+			}
+			AddGraphEdge(edge.from, edge.to,
+						 {stops_[edge.from_stop], stops_[edge.to_stop], buses_[edge.bus], edge.spending}, edge.kind);
+		}
+	}
+
+	void RouteFinder::IndexCatalogue()
+	{
+		// Все остановки будут вершинами графа. Добавим их в словарь для быстрого поиска вершины по названию.
+		// Порядок по именам: сохранённые в базе граф и иерархия подходят к справочнику, загруженному заново
+		stops_ = catalogue_->AllStops();
+		std::sort(stops_.begin(), stops_.end(), [](auto lhs, auto rhs) { return lhs->name < rhs->name; });
+		buses_ = catalogue_->AllBuses();
+		std::sort(buses_.begin(), buses_.end(), [](auto lhs, auto rhs) { return lhs->name < rhs->name; });
+
+		// Вершины остановок идут первыми в обеих моделях
+		stop_vertices_.resize(catalogue_->GetStopCount());
 		graph::VertexId vertexCount = 0;
-		for (auto stop : allStops)
+		for (auto stop : stops_)
 		{
-			stop_to_graph_vertex_.insert({stop, vertexCount++});
+			stop_vertices_[stop->id] = vertexCount++;
 		}
+	}
 
-		// Добавляем грани
-		for (auto* route : catalogue->AllBuses())
+	void RouteFinder::BuildGraph()
+	{
+		IndexCatalogue();
+		if (model_ == GraphModel::StopPairs)
+		{
+			BuildStopPairsGraph();
+		}
+		else
 		{
-			DistanceFinder df(catalogue, route);
-			const auto& stops = route->stops;
+			BuildRideGraph();
+		}
+	}
+
+	void RouteFinder::BuildStopPairsGraph()
+	{
+		graph_ = std::make_unique<NavigationGraph>(stops_.size());
+		for (auto* route : buses_)
+		{
+			DistanceFinder df(catalogue_, route);
+			const auto stops = catalogue_->GetRouteStops(route->id);
 			for (size_t i = 0; i + 1 < stops.size(); ++i) /// UPD делал для того чтобы пользоваться std::abs
 			{
 
@@ -97,10 +228,60 @@ namespace transport
 				}
 			}
 		}
-		router_ = std::make_unique<graph::Router<GraphWeight>>(*graph_);
 	}
 
-	std::optional<std::vector<const TripItem*>> RouteFinder::findRoute(std::string_view from, std::string_view to) const
+	void RouteFinder::BuildRideGraph()
+	{
+		// У некольцевого маршрута две цепочки вершин, туда и обратно: развернуться
+		// на конечной без пересадки нельзя, как и в StopPairs
+		size_t vertexCount = stops_.size();
+		for (auto* route : buses_)
+		{
+			vertexCount += catalogue_->GetRouteStops(route->id).size() * (route->is_roundtrip ? 1 : 2);
+		}
+		graph_ = std::make_unique<NavigationGraph>(vertexCount);
+
+		graph::VertexId rideVertex = stops_.size();
+		for (auto* route : buses_)
+		{
+			DistanceFinder df(catalogue_, route);
+			const auto stops = catalogue_->GetRouteStops(route->id);
+			const int last = static_cast<int>(stops.size()) - 1;
+			const auto addChain = [&](int first, int step) {
+				// вершина «в автобусе у stops[i]» для i = first, first + step, ...
+				const graph::VertexId chainStart = rideVertex;
+				for (int hop = 0; hop <= last; ++hop)
+				{
+					const int i = first + hop * step;
+					const graph::VertexId vertex = chainStart + hop;
+					const graph::VertexId stopVertex = stop_vertices_[stops[i]];
+					const Handbook::Data::StopPtr stop = catalogue_->GetStop(stops[i]);
+					if (hop < last)
+					{
+						AddGraphEdge(stopVertex, vertex,
+									 {stop, stop, route, {0, static_cast<double>(bus_wait_time_), 0}},
+									 EdgeKind::Board);
+						AddGraphEdge(vertex, vertex + 1,
+									 {stop, catalogue_->GetStop(stops[i + step]), route,
+									  {1, 0, df.DistanceBetween(i, i + step) / bus_velocity_}},
+									 EdgeKind::Ride);
+					}
+					if (hop > 0)
+					{
+						AddGraphEdge(vertex, stopVertex, {stop, stop, route, {}}, EdgeKind::Alight);
+					}
+				}
+				rideVertex += stops.size();
+			};
+			addChain(0, 1);
+			if (!route->is_roundtrip)
+			{
+				addChain(last, -1);
+			}
+		}
+	}
+
+	std::optional<std::vector<TripItem>> RouteFinder::findRoute(std::string_view from, std::string_view to) const
 	{
 		Handbook::Data::StopPtr stopFrom = catalogue_->FindStop(from);
 		Handbook::Data::StopPtr stopTo = catalogue_->FindStop(to);
@@ -109,35 +290,68 @@ namespace transport
 			return std::nullopt;
 		}
 
-		std::vector<const TripItem*> result;
+		std::vector<TripItem> result;
 		if (stopFrom == stopTo)
 		{
 			return result;
 		}
 
-		graph::VertexId fromVertexId = stop_to_graph_vertex_.at(stopFrom);
-		graph::VertexId toVertexId = stop_to_graph_vertex_.at(stopTo);
+		graph::VertexId fromVertexId = stop_vertices_.at(stopFrom->id);
+		graph::VertexId toVertexId = stop_vertices_.at(stopTo->id);
 		auto route = router_->BuildRoute(fromVertexId, toVertexId);
 		if (!route.has_value())
 		{
 			return std::nullopt;
 		}
 
+		// Части поездки (посадка, перегоны, высадка) склеиваются в один TripItem
+		const TripItem* boarding = nullptr;
+		Handbook::Data::StopPtr rideEnd = nullptr;
+		TripSpending spending;
 		for (const auto& edge : route.value().edges)
 		{
-			result.push_back(&graph_edges_.at(edge));
+			const TripItem& item = graph_edges_.at(edge);
+			switch (edge_kinds_[edge])
+			{
+			case EdgeKind::Trip:
+				result.push_back(item);
+				break;
+			case EdgeKind::Board:
+				boarding = &item;
+				rideEnd = item.to;
+				spending = item.spending;
+				break;
+			case EdgeKind::Ride:
+				rideEnd = item.to;
+				spending = spending + item.spending;
+				break;
+			case EdgeKind::Alight:
+				// посадка и сразу высадка ничего не дают, такую пару пропускаем
+				if (boarding && spending.stop_count > 0)
+				{
+					result.push_back({boarding->from, rideEnd, boarding->bus, spending});
+				}
+				boarding = nullptr;
+				break;
+			}
 		}
 		return result;
 	}
 
-	void RouteFinder::AddTripItem(Handbook::Data::StopPtr from, Handbook::Data::StopPtr to,
+	void RouteFinder::AddTripItem(Handbook::Data::StopId from, Handbook::Data::StopId to,
 								  Handbook::Data::BusPtr route, TripSpending&& spending)
+	{
+		AddGraphEdge(stop_vertices_[from], stop_vertices_[to],
+					 {catalogue_->GetStop(from), catalogue_->GetStop(to), route, spending},
+					 EdgeKind::Trip);
+	}
+
+	void RouteFinder::AddGraphEdge(graph::VertexId from, graph::VertexId to, TripItem&& item, EdgeKind kind)
 	{
 		using namespace std;
-		TripItem item{from, to, route, spending};
-		int id = graph_->AddEdge(
-			graph::Edge<GraphWeight>{stop_to_graph_vertex_[item.from], stop_to_graph_vertex_[item.to], item.spending});
+		int id = graph_->AddEdge(graph::Edge<GraphWeight>{from, to, item.spending});
 		graph_edges_.push_back(std::move(item));
+		edge_kinds_.push_back(kind);
 		if (id != static_cast<int>(graph_edges_.size() - 1))
 		{
 			throw std::runtime_error("AddEdge error "s + std::to_string(id) + "on graph edges size " +
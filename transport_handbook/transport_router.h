@@ -1,9 +1,12 @@
 #pragma once
 
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
 #include "graph.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -50,25 +53,115 @@ namespace transport {
         std::vector<int> reverse_distances_;
     };
 
+    // Чем RouteFinder ищет путь в графе
+    enum class RoutingEngine {
+        // Флойд - Уоршелл при построении: O(V^3) времени и O(V^2) памяти до первого запроса
+        AllPairs,
+        // Дейкстра на каждый запрос, предварительного расчёта нет
+        Dijkstra,
+        // Contraction Hierarchies: расчёт при построении (make_base), быстрые запросы
+        ContractionHierarchies
+    };
+
+    // Как маршруты автобусов превращаются в граф
+    enum class GraphModel {
+        // Вершина - остановка, ребро - поездка между любыми двумя остановками маршрута:
+        // O(L^2) рёбер на маршрут из L остановок
+        StopPairs,
+        // Вершины остановок плюс вершина «в автобусе» на каждую позицию маршрута:
+        // посадка (ожидание), перегоны и высадка - O(L) рёбер на маршрут
+        RideVertices
+    };
+
     class RouteFinder {
         using GraphWeight = TripSpending;
         using NavigationGraph = graph::DirectedWeightedGraph<GraphWeight>;
 
     public:
-        RouteFinder(Handbook::Data::TransportCatalogue *catalogue, int bus_wait_time, double bus_velocity);
-
-        std::optional<std::vector<const TripItem *>> findRoute(std::string_view from, std::string_view to) const;
+        using Hierarchy = graph::ContractionHierarchy<GraphWeight>;
+
+        // Чем ребро графа является в поездке. Trip - поездка целиком (StopPairs),
+        // остальные - её части в RideVertices
+        enum class EdgeKind : uint8_t {
+            Trip,
+            Board,
+            Ride,
+            Alight
+        };
+
+        // Ребро графа вместе с его TripItem. Остановки и автобусы - индексы в порядке имён;
+        // индекс остановки совпадает с её вершиной в графе
+        struct EdgeData {
+            graph::VertexId from;
+            graph::VertexId to;
+            size_t from_stop;
+            size_t to_stop;
+            size_t bus;
+            TripSpending spending;
+            EdgeKind kind;
+        };
+
+        // Всё, что RouteFinder строит по справочнику: сохраняется в make_base и
+        // загружается в process_requests без пересчёта
+        struct Data {
+            GraphModel model = GraphModel::RideVertices;
+            size_t vertex_count = 0;
+            std::vector<EdgeData> edges;
+            // есть, только если движок - ContractionHierarchies
+            std::optional<Hierarchy::Data> hierarchy;
+        };
+
+        RouteFinder(Handbook::Data::TransportCatalogue *catalogue, int bus_wait_time, double bus_velocity,
+                    RoutingEngine engine = RoutingEngine::Dijkstra, GraphModel model = GraphModel::RideVertices);
+
+        // Иерархия, рассчитанная заранее для того же справочника, тех же настроек и модели графа
+        RouteFinder(Handbook::Data::TransportCatalogue *catalogue, int bus_wait_time, double bus_velocity,
+                    Hierarchy::Data hierarchy, GraphModel model = GraphModel::RideVertices);
+
+        // Граф и иерархия из GetData() для того же справочника и тех же настроек. С иерархией
+        // движок - ContractionHierarchies, без неё - Dijkstra. Несогласованные данные - std::invalid_argument
+        RouteFinder(Handbook::Data::TransportCatalogue *catalogue, int bus_wait_time, double bus_velocity, Data data);
+
+        Data GetData() const;
+
+        // nullptr, если движок - не ContractionHierarchies
+        const Hierarchy *GetHierarchy() const;
+
+        GraphModel GetGraphModel() const;
+
+        // Можно вызывать из нескольких потоков: поиск не меняет ни справочник, ни граф, рабочие массивы движков thread_local
+        std::optional<std::vector<TripItem>> findRoute(std::string_view from, std::string_view to) const;
 
     private:
-        void AddTripItem(Handbook::Data::StopPtr from, Handbook::Data::StopPtr to, Handbook::Data::BusPtr route,
+        void IndexCatalogue();
+
+        void BuildGraph();
+
+        void BuildStopPairsGraph();
+
+        void BuildRideGraph();
+
+        void LoadGraph(const Data &data);
+
+        void AddTripItem(Handbook::Data::StopId from, Handbook::Data::StopId to, Handbook::Data::BusPtr route,
                          TripSpending &&spending);
 
+        void AddGraphEdge(graph::VertexId from, graph::VertexId to, TripItem &&item, EdgeKind kind);
+
     private:
         Handbook::Data::TransportCatalogue *catalogue_;
-        std::unique_ptr<graph::Router<GraphWeight>> router_;
+        GraphModel model_;
+        std::unique_ptr<graph::RouteEngine<GraphWeight>> router_;
+        const Hierarchy *hierarchy_ = nullptr;
         std::unique_ptr<NavigationGraph> graph_;
-        std::unordered_map<Handbook::Data::StopPtr, graph::VertexId> stop_to_graph_vertex_;
+        // остановки и автобусы в порядке имён: граф одного справочника всегда одинаков
+        std::vector<Handbook::Data::StopPtr> stops_;
+        std::vector<Handbook::Data::BusPtr> buses_;
+        // вершина графа по StopId
+        std::vector<graph::VertexId> stop_vertices_;
+        // Что означает каждое ребро графа; у Board и Alight from == to
         std::vector<TripItem> graph_edges_;
+        std::vector<EdgeKind> edge_kinds_;
         int bus_wait_time_ = 0;
         double bus_velocity_ = 0;
     };